@@ -0,0 +1,100 @@
+// ============================================================
+//  buffers.h — fixed-size staging buffers (no heap)
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+// Print target over a fixed array. Output past the end is dropped and
+// flagged, so a caller can discard a partial row instead of writing it.
+template <uint16_t N>
+class LineBuffer : public Print {
+public:
+    void        clear()            { len = 0; overflow = false; }
+    const char* data()       const { return buf; }
+    uint16_t    length()     const { return len; }
+    bool        overflowed() const { return overflow; }
+
+    size_t write(uint8_t c) override {
+        if (len >= N) { overflow = true; return 0; }
+        buf[len++] = (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t* p, size_t n) override {
+        if (n > (size_t)(N - len)) { overflow = true; n = N - len; }
+        memcpy(buf + len, p, n);
+        len += n;
+        return n;
+    }
+    using Print::write;
+
+private:
+    char     buf[N];
+    uint16_t len      = 0;
+    bool     overflow = false;
+};
+
+// Single-producer / single-consumer byte ring. head and tail run freely
+// and are masked on access, so used() is just head - tail. size must be
+// a power of two.
+struct ByteRing {
+    uint8_t* buf;
+    uint32_t size;
+    uint32_t head = 0, tail = 0;
+
+    uint32_t used()  const { return head - tail; }
+    uint32_t space() const { return size - used(); }
+
+    // All-or-nothing: a row is never split across a full buffer.
+    bool push(const void* src, uint32_t n) {
+        if (n > space()) return false;
+        uint32_t at    = head & (size - 1);
+        uint32_t first = min(n, size - at);
+        memcpy(buf + at, src, first);
+        memcpy(buf, (const uint8_t*)src + first, n - first);
+        head += n;
+        return true;
+    }
+    // Longest contiguous readable run starting at tail.
+    uint32_t peek(const uint8_t*& p) const {
+        uint32_t at = tail & (size - 1);
+        p = buf + at;
+        return min(used(), size - at);
+    }
+    void pop(uint32_t n) { tail += n; }
+    void reset()         { head = tail = 0; }
+};
+
+// FIFO of fixed-size records in a caller-supplied array. The record
+// size is set at runtime by format() (ochBlockSize is only known once
+// the INI is parsed), so the slot count follows from the array size.
+struct SlotRing {
+    uint8_t* buf;
+    uint32_t bytes;
+    uint32_t slotSize = 0, slots = 0;
+    uint32_t first = 0, count = 0;   // oldest slot index, slots in use
+
+    void format(uint32_t recordBytes) {
+        slotSize = (recordBytes + 3) & ~3u;   // keep records word-aligned
+        slots    = slotSize ? bytes / slotSize : 0;
+        first = count = 0;
+    }
+    bool     empty() const { return count == 0; }
+    bool     full()  const { return count >= slots; }
+    uint32_t used()  const { return count; }
+
+    // Slot to fill for the next record, or nullptr when full.
+    uint8_t* push() {
+        if (full()) return nullptr;
+        uint32_t at = first + count++;
+        if (at >= slots) at -= slots;
+        return buf + at * slotSize;
+    }
+    uint8_t* front() const { return count ? buf + first * slotSize : nullptr; }
+    void pop() {
+        if (!count) return;
+        count--;
+        if (++first == slots) first = 0;
+    }
+    void reset() { first = count = 0; }
+};
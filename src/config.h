@@ -0,0 +1,74 @@
+// ============================================================
+//  config.h — build-time configuration shared by all modules
+// ============================================================
+#pragma once
+
+#include <stdint.h>
+
+static constexpr uint16_t MAX_CHANNELS     = 300;
+static constexpr uint16_t OCH_BUF_SIZE     = 2948;  // must be >= ochBlockSize
+static constexpr uint8_t  OCH_CMD_MAX      = 16;    // bytes of a compiled ochGetCommand
+static constexpr uint8_t  OCH_PIPELINE     = 4;     // chunk requests in flight when blockingFactor splits a read
+static constexpr uint32_t OCH_RESYNC_MS    = 100;   // quiet line needed before polling again after a pipelined read failed
+static constexpr uint32_t POLL_INTERVAL_MS = 50;    // 20 Hz
+static constexpr uint32_t SYNC_INTERVAL_MS = 1000;  // max age of unsynced rows (loss window on hard power-off)
+static constexpr uint32_t SYNC_CLUSTERS    = 1;     // also sync every N whole clusters written; 0 = age only
+static constexpr uint32_t LOG_PREALLOC_BYTES = 64UL << 20; // reserved per log at open; 0 = off
+static constexpr uint32_t LOOP_BUDGET_US   = 5000;  // one loop() pass should never take longer
+static constexpr uint32_t SD_RING_SIZE     = 65536; // row staging buffer (RAM2), power of two
+static constexpr uint16_t SD_CHUNK         = 4096;  // max bytes handed to the card per drain pass
+static constexpr uint16_t ROW_BUF_SIZE     = 4096;  // one formatted MSL row
+static constexpr uint32_t MTP_IO_BUDGET_US = 2000;  // slack an MTP file read/write waits for while logging
+static constexpr uint8_t  MTP_OPEN_FILES   = 4;     // MTP files and folders open at once (fixed pool)
+static constexpr uint32_t MTP_QUIET_MS     = 2000;  // no MTP transfer for this long before a device reset
+static constexpr uint8_t  FLOAT_DIGITS     = 3;     // decimals when the INI gives none and the scale can't tell
+static constexpr bool     HEALTH_CHANNELS  = true;  // append logger-health columns to every row
+static constexpr bool     SPARSE_LOG       = false; // change-of-value binary .tsb logs (host: --sparse); see sparse.h
+static constexpr bool     SPARSE_PACK_BITS = true;  // .tsb: INI 'bits' flags of one word stored as one value
+static constexpr bool     TELEMETRY        = false; // live records on Serial from boot ('l' / 'q'; host: --telemetry PATH); see telem.h
+static constexpr bool     TELEMETRY_RAW    = false; // stream the raw block instead of decoded f32 columns
+static constexpr uint16_t INI_LINES_PER_PASS = 32;  // INI lines parsed per loop() pass
+static constexpr uint8_t  INI_MAX_SYMBOLS  = 32;    // #set / settingGroups symbols for #if
+static constexpr uint8_t  EXPR_MAX         = 64;    // { expression } channels from the INI
+static constexpr uint16_t EXPR_CODE_BYTES  = 4096;  // bytecode pool for all of them
+static constexpr uint8_t  EXPR_MAX_STACK   = 16;    // evaluation stack depth
+static constexpr uint16_t EXPR_MAX_COST    = 128;   // ops per channel, nested expressions included
+// Channels whose min/max go into /CATALOG.CSV (INI [OutputChannels] names).
+static constexpr const char* CATALOG_KEYS[] = { "RPMValue", "coolant", "TPSValue", "AFRValue" };
+static constexpr uint8_t     CATALOG_KEY_COUNT = sizeof(CATALOG_KEYS) / sizeof(CATALOG_KEYS[0]);
+static constexpr bool     SUMMARY_SIDECAR  = true;  // write <log>.sum (per-column stats) on close
+// Limits for the .sum "time above" column (INI [OutputChannels] names).
+struct SummaryLimit { const char* name; float limit; };
+static constexpr SummaryLimit SUMMARY_LIMITS[] = { { "coolant", 105.0f }, { "RPMValue", 6500.0f }, { "knockLevel", 1.0f } };
+static constexpr uint8_t      SUMMARY_LIMIT_COUNT = sizeof(SUMMARY_LIMITS) / sizeof(SUMMARY_LIMITS[0]);
+static constexpr uint8_t  RATE_MAX_GROUPS  = 4;     // distinct periods in /RATES.CFG
+static constexpr uint8_t  RATE_MAX_RANGES  = 8;     // 'O' requests per rate group
+static constexpr uint16_t RATE_MERGE_GAP   = 16;    // join channels this close into one request
+static constexpr uint8_t  TABLE_MAX        = 4;     // 2D tables from /TABLES.CFG
+static constexpr uint8_t  TABLE_MAX_BINS   = 16;    // per axis (17 edges)
+static constexpr bool     BLACKBOX_MODE    = false; // log only around triggers (host: --blackbox)
+static constexpr uint32_t BLACKBOX_RAM_BYTES = 192UL << 10; // raw-sample ring (RAM2, or PSRAM with -DBLACKBOX_EXTMEM)
+static constexpr uint32_t PRETRIGGER_MS    = 5000;  // history committed when a trigger fires
+static constexpr uint32_t POSTTRIGGER_MS   = 10000; // live capture after the last trigger
+static constexpr uint32_t TRIGGER_POLL_MS  = 10;    // 'O' period while capturing (100 Hz)
+static constexpr int8_t   TRIGGER_PIN      = -1;    // push button to GND; -1 = none
+static constexpr uint8_t  BLACKBOX_REPLAY_ROWS = 4; // buffered rows formatted per loop() pass
+// Black-box trigger conditions (INI [OutputChannels] names). Rises fires
+// when the value goes up between two samples, e.g. a knock counter.
+enum class TrigOp : uint8_t { Above, Below, Rises };
+struct Trigger { const char* channel; TrigOp op; float level; };
+static constexpr Trigger TRIGGERS[] = { { "RPMValue", TrigOp::Above, 6500.0f }, { "knockCount", TrigOp::Rises, 0 } };
+static constexpr uint8_t TRIGGER_COUNT = sizeof(TRIGGERS) / sizeof(TRIGGERS[0]);
+static constexpr bool     AUTO_SESSION     = false; // open/close logs on START_WHEN / STOP_WHEN (host: --auto)
+static constexpr uint32_t IDLE_POLL_MS     = 500;   // 'O' period between sessions
+static constexpr uint32_t STOP_HOLD_MS     = 30000; // STOP_WHEN must hold this long to end a session
+// A session starts when any START_WHEN condition holds and stops when
+// all STOP_WHEN conditions have held for STOP_HOLD_MS.
+static constexpr Trigger START_WHEN[] = { { "RPMValue", TrigOp::Above, 300.0f }, { "VehicleSpeedKph", TrigOp::Above, 5.0f } };
+static constexpr Trigger STOP_WHEN[]  = { { "RPMValue", TrigOp::Below, 1.0f } };
+static constexpr uint8_t START_WHEN_COUNT = sizeof(START_WHEN) / sizeof(START_WHEN[0]);
+static constexpr uint8_t STOP_WHEN_COUNT  = sizeof(STOP_WHEN) / sizeof(STOP_WHEN[0]);
+static constexpr uint32_t SDBENCH_SEQ_BYTES    = 4UL << 20; // per block size in the 'b' throughput pass
+static constexpr uint32_t SDBENCH_LATENCY_MS   = 60000;     // 'b' continuous-write latency pass
+static constexpr uint16_t SDBENCH_FLUSH_ROUNDS = 200;       // 'b' write + flush pairs
+static constexpr uint32_t SDBENCH_SLICE_US     = 2000;      // 'b' work per scheduler pass
@@ -0,0 +1,8 @@
+// ============================================================
+//  crc32.h — CRC-32 (IEEE, reflected) as the TS protocol uses it
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+uint32_t crc32(const uint8_t* data, size_t len);
@@ -0,0 +1,214 @@
+// ============================================================
+//  expr.cpp — expression channels: compiler and stack machine
+// ============================================================
+#include "expr.h"
+#include "ini.h"
+
+enum Op : uint8_t {
+    OP_END, OP_CONST, OP_CHAN,             // CONST: f32 follows, CHAN: u16 index
+    OP_NEG, OP_NOT,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_LT,  OP_LE,  OP_GT,  OP_GE,  OP_EQ, OP_NE,
+    OP_AND, OP_OR,  OP_BAND, OP_BOR, OP_SHL, OP_SHR,
+    OP_SEL                                 // c ? a : b, all three on the stack
+};
+
+static uint8_t  code[EXPR_CODE_BYTES];
+static uint16_t codeLen  = 0;
+static uint16_t exprStart[EXPR_MAX];
+static uint16_t exprCost[EXPR_MAX];        // ops per evaluation, nested expressions included
+static uint8_t  numExprs = 0;
+
+void exprReset() { codeLen = 0; numExprs = 0; }
+
+// ─────────────────────────────────────────────────────────────
+//  Compiler — recursive descent, emits postfix as it goes
+// ─────────────────────────────────────────────────────────────
+static const char* src;          // cursor
+static const char* error;
+static uint16_t    cost;
+static uint8_t     depth, maxDepth;
+
+static void fail(const char* why) { if (!error) error = why; }
+
+static void emit(uint8_t b) {
+    if (codeLen >= EXPR_CODE_BYTES) { fail("code pool full"); return; }
+    code[codeLen++] = b;
+}
+
+// One op that leaves `pops` fewer values on the stack (-1 for a push).
+static void emitOp(Op op, int8_t pops) {
+    emit(op);
+    cost++;
+    depth -= pops;
+    if (depth > maxDepth) maxDepth = depth;
+}
+
+static void skipSpace() { while (*src == ' ' || *src == '\t') src++; }
+
+// Longer operators are tried first at each level, and deeper levels have
+// already taken "<<" and ">>"; only "|" and "&" can still grab half of
+// "||" / "&&".
+static bool accept(const char* tok) {
+    skipSpace();
+    size_t n = strlen(tok);
+    if (strncmp(src, tok, n) != 0) return false;
+    if (n == 1 && (tok[0] == '|' || tok[0] == '&') && src[1] == tok[0]) return false;
+    src += n;
+    return true;
+}
+
+static void parseTernary();
+
+static void parsePrimary() {
+    skipSpace();
+    if (accept("(")) {
+        parseTernary();
+        if (!accept(")")) fail("missing )");
+        return;
+    }
+    if ((*src >= '0' && *src <= '9') || *src == '.') {
+        char* end;
+        float v = (src[0] == '0' && (src[1] == 'x' || src[1] == 'X'))
+            ? (float)strtoul(src, &end, 16) : strtof(src, &end);
+        src = end;
+        emitOp(OP_CONST, -1);
+        uint8_t b[4]; memcpy(b, &v, 4);
+        for (uint8_t k = 0; k < 4; k++) emit(b[k]);
+        return;
+    }
+    if ((*src >= 'A' && *src <= 'Z') || (*src >= 'a' && *src <= 'z') || *src == '_') {
+        char name[sizeof(Channel::name)];
+        size_t n = 0;
+        while ((*src >= 'A' && *src <= 'Z') || (*src >= 'a' && *src <= 'z') ||
+               (*src >= '0' && *src <= '9') || *src == '_') {
+            if (n < sizeof(name) - 1) name[n++] = *src;
+            src++;
+        }
+        name[n] = '\0';
+        int16_t idx = findChannelByName(name);
+        if (idx < 0) { fail("unknown name"); return; }
+        if (channels[idx].dk == DK_EXPR) cost += exprCost[channels[idx].expr];
+        emitOp(OP_CHAN, -1);
+        emit((uint8_t)(idx & 0xFF));
+        emit((uint8_t)(idx >> 8));
+        return;
+    }
+    fail("syntax");
+}
+
+static void parseUnary() {
+    if      (accept("-")) { parseUnary(); emitOp(OP_NEG, 0); }
+    else if (accept("!")) { parseUnary(); emitOp(OP_NOT, 0); }
+    else if (accept("+")) { parseUnary(); }
+    else                  parsePrimary();
+}
+
+// One left-associative precedence level.
+struct BinOp { const char* tok; Op op; };
+static void parseLevel(uint8_t level);
+
+static const BinOp LEVEL_OPS[][5] = {
+    { { "||", OP_OR  } },
+    { { "&&", OP_AND } },
+    { { "|",  OP_BOR } },
+    { { "&",  OP_BAND } },
+    { { "==", OP_EQ  }, { "!=", OP_NE } },
+    { { "<=", OP_LE  }, { ">=", OP_GE }, { "<", OP_LT }, { ">", OP_GT } },
+    { { "<<", OP_SHL }, { ">>", OP_SHR } },
+    { { "+",  OP_ADD }, { "-",  OP_SUB } },
+    { { "*",  OP_MUL }, { "/",  OP_DIV }, { "%", OP_MOD } },
+};
+static constexpr uint8_t LEVELS = sizeof(LEVEL_OPS) / sizeof(LEVEL_OPS[0]);
+
+static void parseOperand(uint8_t level) {
+    if (level + 1 < LEVELS) parseLevel(level + 1);
+    else                    parseUnary();
+}
+
+static void parseLevel(uint8_t level) {
+    parseOperand(level);
+    for (;;) {
+        if (error) return;
+        const BinOp* hit = nullptr;
+        for (const BinOp& b : LEVEL_OPS[level])
+            if (b.tok && accept(b.tok)) { hit = &b; break; }
+        if (!hit) return;
+        parseOperand(level);
+        emitOp(hit->op, 1);
+    }
+}
+
+static void parseTernary() {
+    parseLevel(0);
+    if (error || !accept("?")) return;
+    parseTernary();
+    if (!accept(":")) { fail("missing :"); return; }
+    parseTernary();
+    emitOp(OP_SEL, 2);
+}
+
+int16_t exprCompile(const char* text, const char** err) {
+    if (numExprs >= EXPR_MAX) { *err = "too many expressions"; return -1; }
+    uint16_t start = codeLen;
+    src = text; error = nullptr; cost = 0; depth = 0; maxDepth = 0;
+    parseTernary();
+    skipSpace();
+    if (*src)                      fail("syntax");
+    if (maxDepth > EXPR_MAX_STACK) fail("too deep");
+    if (cost > EXPR_MAX_COST)      fail("too costly");
+    emit(OP_END);
+    if (error) { codeLen = start; *err = error; return -1; }
+    exprStart[numExprs] = start;
+    exprCost[numExprs]  = cost;
+    return numExprs++;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Evaluation
+// ─────────────────────────────────────────────────────────────
+float exprEval(uint16_t id, const uint8_t* blob) {
+    float   st[EXPR_MAX_STACK];
+    uint8_t sp = 0;
+    const uint8_t* pc = code + exprStart[id];
+    for (;;) {
+        uint8_t op = *pc++;
+        switch (op) {
+            case OP_END:   return st[0];
+            case OP_CONST: memcpy(&st[sp++], pc, 4); pc += 4; break;
+            case OP_CHAN: {
+                uint16_t i = pc[0] | (pc[1] << 8);
+                pc += 2;
+                st[sp++] = decodeChannel(blob, channels[i]);
+                break;
+            }
+            case OP_NEG:   st[sp-1] = -st[sp-1];        break;
+            case OP_NOT:   st[sp-1] = st[sp-1] == 0;    break;
+            case OP_SEL:   sp -= 2; st[sp-1] = st[sp-1] != 0 ? st[sp] : st[sp+1]; break;
+            default: {
+                float b = st[--sp], a = st[sp-1], r = 0;
+                int32_t ia = (int32_t)a, ib = (int32_t)b;
+                switch (op) {
+                    case OP_ADD:  r = a + b; break;
+                    case OP_SUB:  r = a - b; break;
+                    case OP_MUL:  r = a * b; break;
+                    case OP_DIV:  r = b != 0 ? a / b : 0; break;
+                    case OP_MOD:  r = ib != 0 ? (float)(ia % ib) : 0; break;
+                    case OP_LT:   r = a <  b; break;
+                    case OP_LE:   r = a <= b; break;
+                    case OP_GT:   r = a >  b; break;
+                    case OP_GE:   r = a >= b; break;
+                    case OP_EQ:   r = a == b; break;
+                    case OP_NE:   r = a != b; break;
+                    case OP_AND:  r = a != 0 && b != 0; break;
+                    case OP_OR:   r = a != 0 || b != 0; break;
+                    case OP_BAND: r = (float)(ia & ib); break;
+                    case OP_BOR:  r = (float)(ia | ib); break;
+                    case OP_SHL:  r = (float)((uint32_t)ia << (ib & 31)); break;
+                    case OP_SHR:  r = (float)(ia >> (ib & 31)); break;
+                }
+                st[sp-1] = r;
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+// ============================================================
+//  expr.h — [OutputChannels] { expression } channels
+// ============================================================
+//
+//  TunerStudio INIs define derived channels as expressions over other
+//  channels:
+//
+//    AFR2      = { lambdaValue * 14.7 }, "AFR"
+//    fanDuty   = { isFan ? 100 : 0 }, "%"
+//
+//  exprCompile() turns the text into postfix bytecode once, while the
+//  INI is parsed; channel names become indexes into channels[]. Rows
+//  then run exprEval(): a small stack machine, no strings, no jumps (both
+//  sides of ?: are evaluated), so the cost of a channel is fixed at
+//  compile time and capped at EXPR_MAX_COST operations, counting those
+//  of any expression channel it uses.
+//
+//  Operators, C precedence: ?:  ||  &&  |  &  == !=  < <= > >=  << >>
+//  + -  * / %  unary - !  and ( ). Numbers are decimal or 0x hex.
+//  Only channels defined earlier in [OutputChannels] can be named, so
+//  there are no cycles. Division or % by zero gives 0.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+struct Channel;
+
+// Compile src into a new expression. Returns its id, or -1 with a short
+// reason in *err (unknown name, syntax, too long, too costly).
+int16_t exprCompile(const char* src, const char** err);
+float   exprEval(uint16_t id, const uint8_t* blob);
+void    exprReset();             // forget all expressions (new INI)
@@ -0,0 +1,33 @@
+// ============================================================
+//  hal.cpp — platform-independent HAL helpers
+// ============================================================
+#include "hal.h"
+
+// Civil-from-days / days-from-civil (proleptic Gregorian, no time zone),
+// giving the same fields TimeLib's breakTime()/makeTime() produce.
+void toDateTime(uint32_t t, DateTime& dt) {
+    uint32_t days = t / 86400, secs = t % 86400;
+    dt.hour   = secs / 3600;
+    dt.minute = (secs / 60) % 60;
+    dt.second = secs % 60;
+
+    int32_t  z   = (int32_t)days + 719468;
+    int32_t  era = z / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp  = (5 * doy + 2) / 153;
+    dt.day   = doy - (153 * mp + 2) / 5 + 1;
+    dt.month = mp < 10 ? mp + 3 : mp - 9;
+    dt.year  = yoe + era * 400 + (dt.month <= 2);
+}
+
+uint32_t fromDateTime(const DateTime& dt) {
+    int32_t  y   = dt.year - (dt.month <= 2);
+    int32_t  era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (dt.month + (dt.month > 2 ? -3 : 9)) + 2) / 5 + dt.day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = (uint32_t)(era * 146097 + (int32_t)doe - 719468);
+    return days * 86400 + dt.hour * 3600 + dt.minute * 60 + dt.second;
+}
@@ -0,0 +1,118 @@
+// ============================================================
+//  hal.h — hardware abstraction for the portable logger core
+// ============================================================
+//
+//  ini, logger, scheduler and prof only reach hardware through the
+//  interfaces below. hal_teensy.cpp binds them to USBHost_t36,
+//  SD/SdFat, millis()/micros() and Teensy3Clock; native/hal_posix.cpp
+//  binds them to a tty / pty / socket fd, a directory or RAM, and the
+//  host clocks, so the same core runs under Linux.
+//
+//  The platform fills in `hal` before calling loggerBegin().
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+// ─── Monotonic clock ────────────────────────────────────────
+class Clock {
+public:
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+};
+
+// ─── Real-time clock ────────────────────────────────────────
+// Seconds since 1970 in local time, as TimeLib / Teensy3Clock keep it.
+class Rtc {
+public:
+    virtual uint32_t get() = 0;
+    virtual void     set(uint32_t t) = 0;
+};
+
+struct DateTime {
+    uint16_t year;
+    uint8_t  month, day, hour, minute, second;
+};
+
+void     toDateTime(uint32_t t, DateTime& dt);
+uint32_t fromDateTime(const DateTime& dt);
+
+// ─── ECU transport ──────────────────────────────────────────
+// Byte stream to the ECU plus the modem lines the TS handshake uses.
+class EcuPort {
+public:
+    virtual bool   connected() = 0;
+    virtual int    available() = 0;
+    virtual int    read() = 0;
+    virtual size_t read(uint8_t* buf, size_t n) = 0;   // up to n already-received bytes
+    virtual size_t write(const uint8_t* buf, size_t n) = 0;
+    virtual void   setDTR(bool on) = 0;
+    virtual void   setRTS(bool on) = 0;
+    virtual void   task() {}                           // service the link (USB host)
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+};
+
+// ─── Storage ────────────────────────────────────────────────
+enum class FileMode : uint8_t {
+    Read,       // existing file, from the start
+    Append,     // create if missing, write at the end (SD FILE_WRITE)
+    Overwrite,  // create or truncate
+};
+
+// An open file. Handles come from Storage::open() and go back through
+// Storage::close(); implementations hand them out from a fixed pool.
+class FileHandle : public Print {
+public:
+    virtual int      read() = 0;
+    virtual int      read(void* buf, size_t n) = 0;
+    virtual size_t   write(const uint8_t* buf, size_t n) override = 0;
+    virtual void     flush() override = 0;
+    virtual uint64_t size() = 0;
+    virtual uint64_t position() = 0;
+    virtual bool     seek(uint64_t pos) = 0;
+    // Reserve contiguous clusters for an empty file, so later syncs write
+    // no FAT chain, only the data and the size in the directory entry;
+    // false where unsupported. truncate() cuts the file at the current
+    // position and releases what was not used.
+    virtual bool     preAllocate(uint64_t bytes) { (void)bytes; return false; }
+    virtual bool     truncate() { return false; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    using Print::write;
+};
+
+class Storage {
+public:
+    virtual bool        exists(const char* path) = 0;
+    virtual bool        mkdir(const char* path) = 0;
+    virtual bool        remove(const char* path) = 0;
+    virtual FileHandle* open(const char* path, FileMode mode) = 0;  // nullptr on failure
+    virtual void        close(FileHandle* f) = 0;
+    virtual uint32_t    clusterBytes() { return 0; }   // 0 = unknown
+};
+
+// ─── Telemetry link ─────────────────────────────────────────
+// Host-facing byte stream for live records (telem.h). write() is only
+// called with at most availableForWrite() bytes and must not block.
+class TelemetryPort {
+public:
+    virtual int    availableForWrite() = 0;   // 0 while no host is listening
+    virtual size_t write(const uint8_t* buf, size_t n) = 0;
+};
+
+// ─── Binding ────────────────────────────────────────────────
+struct Hal {
+    Clock*   clock;
+    Rtc*     rtc;
+    EcuPort* ecu;
+    Storage* fs;
+    void   (*led)(bool on);   // status LED; may be nullptr
+    bool   (*trigger)();      // black-box trigger input, true = pressed; may be nullptr
+    TelemetryPort* telemetry; // live stream; may be nullptr
+};
+
+extern Hal hal;
+
+static inline uint32_t halMillis() { return hal.clock->millis(); }
+static inline uint32_t halMicros() { return hal.clock->micros(); }
@@ -0,0 +1,110 @@
+// ============================================================
+//  hal_teensy.cpp — hal.h on the Teensy 4.1
+// ============================================================
+//
+//  ECU transport  USBSerial_BigBuffer on the USB host port
+//  Storage        SD (SdFat / SdFs, exFAT + FAT32) on the SDIO slot
+//  Clock          millis() / micros()
+//  RTC            Teensy3Clock (VBAT backed), mirrored into TimeLib
+//  Telemetry      the device-side Serial, shared with the text console
+// ============================================================
+#include "hal_teensy.h"
+#include <SD.h>       // Teensy's SD wraps SdFat (SdFs) — supports exFAT + FS& for MTP
+#include <TimeLib.h>  // Teensy 4.1 internal RTC (backed by VBAT)
+
+// ─── USB host ───────────────────────────────────────────────
+USBHost             myusb;
+USBHub              hub1(myusb);
+USBSerial_BigBuffer userial(myusb, 1);
+
+class UsbEcuPort : public EcuPort {
+public:
+    bool   connected() override { return (bool)userial; }
+    int    available() override { return userial.available(); }
+    int    read()      override { return userial.read(); }
+    size_t read(uint8_t* buf, size_t n) override {
+        size_t i = 0;
+        while (i < n && userial.available()) buf[i++] = userial.read();
+        return i;
+    }
+    size_t write(const uint8_t* buf, size_t n) override { return userial.write(buf, n); }
+    void   setDTR(bool on) override { userial.setDTR(on); }
+    void   setRTS(bool on) override { userial.setRTS(on); }
+    void   task() override { myusb.Task(); }
+};
+
+// ─── Clock / RTC ────────────────────────────────────────────
+class TeensyClock : public Clock {
+public:
+    uint32_t millis() override { return ::millis(); }
+    uint32_t micros() override { return ::micros(); }
+};
+
+class TeensyRtc : public Rtc {
+public:
+    uint32_t get() override { return Teensy3Clock.get(); }
+    void     set(uint32_t t) override { Teensy3Clock.set(t); setTime(t); }
+};
+
+// ─── Telemetry ──────────────────────────────────────────────
+// Frames go out between console lines on the same Serial; a closed
+// port (no DTR) takes nothing, so records are dropped, not queued.
+class SerialTelemetry : public TelemetryPort {
+public:
+    int    availableForWrite() override { return Serial ? Serial.availableForWrite() : 0; }
+    size_t write(const uint8_t* buf, size_t n) override { return Serial.write(buf, n); }
+};
+
+// ─── SD ─────────────────────────────────────────────────────
+// Files are opened on SD.sdfs (the SdFs volume behind Teensy's SD) as
+// FsFile, which exposes preAllocate()/truncate() that File hides. MTP
+// keeps using the SD FS& on the same volume.
+class SdFileHandle : public FileHandle {
+public:
+    FsFile f;
+
+    int      read() override                      { return f.read(); }
+    int      read(void* buf, size_t n) override   { return f.read(buf, n); }
+    size_t   write(const uint8_t* buf, size_t n) override { return f.write(buf, n); }
+    void     flush() override                     { f.sync(); }   // also the directory entry once the size moved
+    uint64_t size() override                      { return f.fileSize(); }
+    uint64_t position() override                  { return f.curPosition(); }
+    bool     seek(uint64_t pos) override          { return f.seekSet(pos); }
+    bool     preAllocate(uint64_t bytes) override { return f.preAllocate(bytes); }
+    bool     truncate() override                  { return f.truncate(); }
+    using FileHandle::write;
+};
+
+class SdStorage : public Storage {
+public:
+    bool exists(const char* path) override { return SD.exists(path); }
+    bool mkdir(const char* path)  override { return SD.mkdir(path); }
+    bool remove(const char* path) override { return SD.remove(path); }
+
+    FileHandle* open(const char* path, FileMode mode) override {
+        for (SdFileHandle& h : pool) {
+            if (h.f.isOpen()) continue;
+            oflag_t flags = mode == FileMode::Read      ? O_RDONLY
+                          : mode == FileMode::Overwrite ? (O_RDWR | O_CREAT | O_TRUNC)
+                          :                               (O_RDWR | O_CREAT | O_AT_END);
+            h.f = SD.sdfs.open(path, flags);
+            return h.f.isOpen() ? &h : nullptr;
+        }
+        return nullptr;
+    }
+    void close(FileHandle* fh) override {
+        if (fh) static_cast<SdFileHandle*>(fh)->f.close();
+    }
+    uint32_t clusterBytes() override { return SD.sdfs.bytesPerCluster(); }
+
+private:
+    SdFileHandle pool[6];
+};
+
+static UsbEcuPort  usbEcu;
+static TeensyClock teensyClock;
+static TeensyRtc   teensyRtc;
+static SdStorage   sdStorage;
+static SerialTelemetry serialTelemetry;
+
+Hal hal = { &teensyClock, &teensyRtc, &usbEcu, &sdStorage, nullptr, nullptr, &serialTelemetry };
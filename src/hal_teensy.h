@@ -0,0 +1,9 @@
+// ============================================================
+//  hal_teensy.h — Teensy 4.1 HAL binding (USB host, SD, RTC)
+// ============================================================
+#pragma once
+
+#include <USBHost_t36.h>
+#include "hal.h"
+
+extern USBHost myusb;
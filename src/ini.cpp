@@ -0,0 +1,592 @@
+// ============================================================
+//  ini.cpp — TunerStudio INI parser
+// ============================================================
+#include "ini.h"
+#include "expr.h"
+#include "hal.h"
+#include <ctype.h>
+#include <math.h>
+
+Channel   channels[MAX_CHANNELS];
+uint16_t  numChannels  = 0;
+uint16_t  ochBlockSize = 0;
+OchCommand ochCommand;
+
+DLChannel dlChannels[MAX_CHANNELS];
+uint16_t  numDLChannels = 0;
+
+// ─────────────────────────────────────────────────────────────
+//  String helpers
+// ─────────────────────────────────────────────────────────────
+void trimRight(char* s) {
+    int n = (int)strlen(s);
+    while (n > 0 && (s[n-1]==' '||s[n-1]=='\t'||s[n-1]=='\r'||s[n-1]=='\n'))
+        s[--n] = '\0';
+}
+
+bool readLine(FileHandle* f, char* buf, size_t maxLen) {
+    size_t i = 0;
+    int c;
+    while ((c = f->read()) >= 0) {
+        if (c == '\n') break;
+        if (c == '\r') continue;
+        if (i < maxLen - 1) buf[i++] = (char)c;
+    }
+    buf[i] = '\0';
+    return (i > 0 || c >= 0);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  INI filename from signature hash
+// ─────────────────────────────────────────────────────────────
+static uint32_t djb2(const char* s) {
+    uint32_t h = 5381;
+    while (*s) h = ((h << 5) + h) ^ (uint8_t)*s++;
+    return h;
+}
+
+void sigToFilename(const char* sig, char* out, size_t outLen) {
+    snprintf(out, outLen, "%08lX.INI", (unsigned long)djb2(sig));
+}
+
+// ─────────────────────────────────────────────────────────────
+//  INI parser
+// ─────────────────────────────────────────────────────────────
+static TypeCode strToTC(const char* t) {
+    if (!strcmp(t,"U08")||!strcmp(t,"UBYTE")) return TC_U08;
+    if (!strcmp(t,"S08")||!strcmp(t,"BYTE"))  return TC_S08;
+    if (!strcmp(t,"U16")||!strcmp(t,"UINT"))  return TC_U16;
+    if (!strcmp(t,"S16")||!strcmp(t,"INT"))   return TC_S16;
+    if (!strcmp(t,"U32")||!strcmp(t,"ULONG")) return TC_U32;
+    if (!strcmp(t,"S32")||!strcmp(t,"LONG"))  return TC_S32;
+    if (!strcmp(t,"F32")||!strcmp(t,"FLOAT")) return TC_F32;
+    return TC_UNKNOWN;
+}
+
+static void consumeField(const char*& p, char* out, size_t outLen) {
+    while (*p == ' ' || *p == '\t') p++;
+    size_t i = 0;
+    bool quoted = (*p == '"');
+    if (quoted) p++;
+    while (*p) {
+        if ( quoted && *p == '"') { p++; break; }
+        if (!quoted && *p == ',') break;
+        if (i < outLen - 1) out[i++] = *p;
+        p++;
+    }
+    out[i] = '\0';
+    trimRight(out);
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == ',') p++;
+}
+
+// Integer types whose mul and add are short decimals (0.01, -40) decode
+// as fixed point: raw * (mul * 10^d) + add * 10^d, all integers.
+static void planDecode(Channel& ch, double mul, double add) {
+    static constexpr uint8_t FIXED_MAX_DIGITS = 6;
+    ch.dk = DK_FLOAT;
+    ch.digits = FLOAT_DIGITS;
+    if (ch.tc == TC_F32) return;
+    if (mul == 1 && add == 0) {
+        ch.dk = DK_INT; ch.fixDigits = 0; ch.fixMul = 1; ch.fixAdd = 0;
+        ch.digits = 0;
+        return;
+    }
+    double scale = 1;
+    for (uint8_t d = 0; d <= FIXED_MAX_DIGITS; d++, scale *= 10) {
+        double m = mul * scale, a = add * scale;
+        if (fabs(m) >= INT32_MAX || fabs(a) >= INT32_MAX) return;
+        // round(m) == 0: a scale below 10^-d would pass the tolerance as 0.
+        if (round(m) == 0 || fabs(m - round(m)) > 1e-6 || fabs(a - round(a)) > 1e-6) continue;
+        ch.dk = DK_FIXED; ch.fixDigits = d;
+        ch.fixMul = (int32_t)round(m); ch.fixAdd = (int32_t)round(a);
+        ch.digits = min(d, FLOAT_DIGITS);
+        return;
+    }
+}
+
+// Decimals from a printf-style format: "%.2f" → 2, "%d" → 0, -1 if unknown.
+static int8_t formatDigits(const char* fmt) {
+    const char* pc = strchr(fmt, '%');
+    if (!pc) return -1;
+    const char* p = pc + 1;
+    while (*p && strchr("-+ #0123456789", *p)) p++;
+    int prec = -1;
+    if (*p == '.') { prec = atoi(++p); while (*p >= '0' && *p <= '9') p++; }
+    if (*p == 'd' || *p == 'i' || *p == 'u') return 0;
+    if (prec < 0 || (*p != 'f' && *p != 'F')) return -1;
+    return (int8_t)min(prec, 7);
+}
+
+// name = { expression }, "units" — compiled once, evaluated per row.
+static bool parseExprChannel(const char* p, Channel& ch) {
+    const char* close = strchr(p, '}');
+    if (!close) return false;
+    char text[160];
+    size_t n = (size_t)(close - p);
+    const char* why = nullptr;
+    int16_t id = -1;
+    if (n >= sizeof(text)) {
+        why = "expression longer than 159 characters";   // never compile a truncated one
+    } else {
+        memcpy(text, p, n);
+        text[n] = '\0';
+        id = exprCompile(text, &why);
+    }
+    if (id < 0) {
+        Serial.print("[INI] Skipping expression "); Serial.print(ch.name);
+        Serial.print(": "); Serial.println(why);
+        return false;
+    }
+    p = close + 1;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == ',') { p++; consumeField(p, ch.unit, sizeof(ch.unit)); }
+    ch.tc = TC_F32; ch.mul = 1; ch.add = 0;
+    ch.dk = DK_EXPR; ch.expr = (uint8_t)id;
+    ch.digits = FLOAT_DIGITS;
+    return true;
+}
+
+static bool parseChannelLine(const char* line, Channel& ch) {
+    const char* eq = strchr(line, '=');
+    if (!eq) return false;
+
+    size_t ni = 0;
+    for (const char* p = line; p < eq && ni < sizeof(ch.name)-1; p++)
+        if (*p != ' ' && *p != '\t') ch.name[ni++] = *p;
+    ch.name[ni] = '\0';
+    if (ni == 0) return false;
+
+    const char* p = eq + 1;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '{') return parseExprChannel(p + 1, ch);
+    bool isBits = strncmp(p, "bits", 4) == 0;
+    if (!isBits && strncmp(p, "scalar", 6) != 0) return false;
+    p += isBits ? 4 : 6;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == ',') p++;
+
+    char f[32];
+    consumeField(p, f, sizeof(f));
+    TypeCode tc = strToTC(f);
+    if (tc == TC_UNKNOWN) return false;
+
+    consumeField(p, f, sizeof(f));
+    uint16_t offset = (uint16_t)atoi(f);
+    if (offset >= OCH_BUF_SIZE) return false;
+
+    if (isBits) {
+        // bits, U32, offset, [lo:hi] — the option strings after it are not needed.
+        consumeField(p, f, sizeof(f));
+        const char* colon = strchr(f, ':');
+        if (f[0] != '[' || !colon) return false;
+        int lo = atoi(f + 1), hi = atoi(colon + 1);
+        int typeBits = tc == TC_U08 || tc == TC_S08 ? 8 : tc == TC_U16 || tc == TC_S16 ? 16 : 32;
+        if (tc == TC_F32 || lo < 0 || hi < lo || hi >= typeBits) return false;
+        ch.offset = offset; ch.tc = tc; ch.mul = 1; ch.add = 0;
+        ch.dk = DK_BITS; ch.fixDigits = 0; ch.fixMul = 1; ch.fixAdd = 0;
+        ch.bitLo = (uint8_t)lo; ch.bitWidth = (uint8_t)(hi - lo + 1);
+        ch.digits = 0;
+        return true;
+    }
+
+    consumeField(p, ch.unit, sizeof(ch.unit));
+    consumeField(p, f, sizeof(f)); double mul = atof(f);
+    consumeField(p, f, sizeof(f)); double add = atof(f);
+    ch.tc = tc;
+    planDecode(ch, mul, add);
+
+    // Optional min, max, digits.
+    consumeField(p, f, sizeof(f));
+    consumeField(p, f, sizeof(f));
+    consumeField(p, f, sizeof(f));
+    if (f[0] >= '0' && f[0] <= '9') ch.digits = (uint8_t)min(atoi(f), 7);
+
+    ch.offset = offset; ch.mul = (float)mul; ch.add = (float)add;
+    return true;
+}
+
+int16_t findChannelByName(const char* name) {
+    for (uint16_t i = 0; i < numChannels; i++)
+        if (strcmp(channels[i].name, name) == 0) return (int16_t)i;
+    return -1;
+}
+
+static FileHandle* iniFile = nullptr;
+static bool iniInOCH = false, iniInDL = false, iniInSG = false;
+
+// ─────────────────────────────────────────────────────────────
+//  Preprocessor — #set / #unset / #if / #else / #endif
+// ─────────────────────────────────────────────────────────────
+// Symbols come from #set lines and from the first settingOption of each
+// [SettingGroups] group (TunerStudio's default; "DEFAULT" sets nothing).
+// Lines inside an inactive block are skipped by skipLine() unless they
+// start with '#', so large inactive sections cost one scan each.
+static char     ppSymbols[INI_MAX_SYMBOLS][24];
+static uint8_t  ppNumSymbols = 0;
+static uint8_t  ppDepth      = 0;     // open #if blocks
+static uint32_t ppActive     = 1;     // bit d: lines at depth d are live
+static uint32_t ppTaken      = 0;     // bit d: that #if's condition held
+static uint32_t ppSkipped    = 0;     // inactive lines, for the summary
+static bool     ppTooDeep    = false; // #if past depth 31: the INI cannot be parsed
+static bool     sgPending    = false; // next settingOption is its group's default
+
+static bool ppLive() { return (ppActive >> ppDepth) & 1; }
+
+static int8_t ppFind(const char* sym) {
+    for (uint8_t i = 0; i < ppNumSymbols; i++) if (!strcmp(ppSymbols[i], sym)) return i;
+    return -1;
+}
+
+static void ppSet(const char* sym, bool on) {
+    int8_t i = ppFind(sym);
+    if (on && i < 0 && ppNumSymbols < INI_MAX_SYMBOLS) {
+        strncpy(ppSymbols[ppNumSymbols], sym, sizeof(ppSymbols[0]) - 1);
+        ppSymbols[ppNumSymbols++][sizeof(ppSymbols[0]) - 1] = '\0';
+    } else if (!on && i >= 0) {
+        memcpy(ppSymbols[i], ppSymbols[--ppNumSymbols], sizeof(ppSymbols[0]));
+    }
+}
+
+// First word after the directive.
+static void ppWord(const char* p, char* out, size_t outLen) {
+    while (*p == ' ' || *p == '\t') p++;
+    size_t n = 0;
+    while (*p && *p != ' ' && *p != '\t' && *p != '=' && n < outLen - 1) out[n++] = *p++;
+    out[n] = '\0';
+}
+
+// The text after a directive keyword, or nullptr if the line is not that
+// directive: "#ifdef" is not "#if", "#settings" is not "#set".
+static const char* ppIs(const char* line, const char* kw) {
+    size_t n = strlen(kw);
+    if (strncmp(line, kw, n)) return nullptr;
+    char c = line[n];
+    return c == ' ' || c == '\t' || c == '\0' ? line + n : nullptr;
+}
+
+static void ppDirective(const char* line) {
+    char sym[24];
+    const char* rest;
+    if ((rest = ppIs(line, "#if"))) {
+        if (ppDepth == 31) { ppTooDeep = true; return; }   // its #endif would close the wrong block
+        ppWord(rest, sym, sizeof(sym));
+        bool cond = ppFind(sym) >= 0;
+        ppDepth++;
+        ppTaken  = (ppTaken  & ~(1UL << ppDepth)) | ((uint32_t)cond << ppDepth);
+        ppActive = (ppActive & ~(1UL << ppDepth)) | ((uint32_t)(cond && ((ppActive >> (ppDepth - 1)) & 1)) << ppDepth);
+    } else if (ppIs(line, "#else")) {
+        if (!ppDepth) return;
+        bool live = ((ppActive >> (ppDepth - 1)) & 1) && !((ppTaken >> ppDepth) & 1);
+        ppActive = (ppActive & ~(1UL << ppDepth)) | ((uint32_t)live << ppDepth);
+    } else if (ppIs(line, "#endif")) {
+        if (ppDepth) ppDepth--;
+    } else if (ppLive() && (rest = ppIs(line, "#set"))) {
+        ppWord(rest, sym, sizeof(sym)); ppSet(sym, true);
+    } else if (ppLive() && (rest = ppIs(line, "#unset"))) {
+        ppWord(rest, sym, sizeof(sym)); ppSet(sym, false);
+    }
+    // #define (list macros for dialogs) and anything else: not needed here.
+}
+
+// The rest of an inactive line, without copying it. A directive is
+// still returned in buf so #else / #endif are seen.
+static bool skipLine(FileHandle* f, char* buf, size_t maxLen) {
+    int c;
+    while ((c = f->read()) == ' ' || c == '\t') {}
+    if (c == '#') {
+        buf[0] = '#';
+        readLine(f, buf + 1, maxLen - 1);
+        return true;
+    }
+    buf[0] = '\0';
+    if (c < 0) return false;
+    ppSkipped++;
+    while (c >= 0 && c != '\n') c = f->read();
+    return true;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Output-channel request — ochGetCommand, blockingFactor, endianness
+// ─────────────────────────────────────────────────────────────
+static const char* const OCH_DEFAULT_COMMAND = "O%2o%2c";
+static bool ochCmdSeen = false, endianSeen = false;
+
+// "O%2o%2c", "r\$tsCanId\x07%2o%2c": %No / %Nc are the N-byte offset
+// and count, \xNN is one byte and \$tsCanId the CAN id of the ECU on
+// the other end of the cable, 0.
+static bool compileOchCommand(const char* s, OchCommand& c) {
+    c.len = 0; c.offWidth = 0; c.cntWidth = 0;
+    while (*s) {
+        if (*s == '%') {
+            uint8_t w = 2;
+            s++;
+            if (*s >= '1' && *s <= '4') w = *s++ - '0';
+            if ((*s != 'o' && *s != 'c') || c.len + w > OCH_CMD_MAX) return false;
+            if (*s++ == 'o') { c.offPos = c.len; c.offWidth = w; }
+            else             { c.cntPos = c.len; c.cntWidth = w; }
+            memset(c.bytes + c.len, 0, w);
+            c.len += w;
+            continue;
+        }
+        if (c.len >= OCH_CMD_MAX) return false;
+        if (s[0] == '\\' && s[1] == 'x' && isxdigit(s[2]) && isxdigit(s[3])) {
+            char hex[3] = { s[2], s[3], '\0' };
+            c.bytes[c.len++] = (uint8_t)strtoul(hex, nullptr, 16);
+            s += 4;
+        } else if (!strncmp(s, "\\$tsCanId", 9)) {
+            c.bytes[c.len++] = 0;
+            s += 9;
+        } else {
+            c.bytes[c.len++] = (uint8_t)*s++;
+        }
+    }
+    return c.len > 0;
+}
+
+static void putField(uint8_t* p, uint8_t width, uint32_t v) {
+    for (uint8_t i = 0; i < width; i++)
+        p[ochCommand.bigEndian ? width - 1 - i : i] = (uint8_t)(v >> (8 * i));
+}
+
+uint8_t ochRequest(uint16_t offset, uint16_t count, uint8_t* out) {
+    memcpy(out, ochCommand.bytes, ochCommand.len);
+    putField(out + ochCommand.offPos, ochCommand.offWidth, offset);
+    putField(out + ochCommand.cntPos, ochCommand.cntWidth, count);
+    return ochCommand.len;
+}
+
+// Request size once the whole INI is known.
+static void planChunks() {
+    uint16_t chunk = ochBlockSize;
+    if (ochCommand.blockingFactor && ochCommand.blockingFactor < chunk) chunk = ochCommand.blockingFactor;
+    if (ochCommand.cntWidth == 1 && chunk > 255) chunk = 255;
+    if (!ochCommand.ranged() && chunk < ochBlockSize) {
+        Serial.println("[INI] WARNING: ochGetCommand has no %o/%c, reading the block in one request");
+        chunk = ochBlockSize;
+    }
+    ochCommand.chunk = chunk;
+}
+
+// The value of `key = value`, or nullptr for any other line.
+static const char* keyValue(const char* line, const char* key) {
+    size_t n = strlen(key);
+    if (strncmp(line, key, n) != 0) return nullptr;
+    const char* p = line + n;
+    while (*p == ' ' || *p == '\t') p++;
+    return *p == '=' ? p + 1 : nullptr;
+}
+
+// Protocol settings; the first definition wins, like ochBlockSize.
+static bool parseProtocolLine(const char* line) {
+    const char* v;
+    char text[48];
+    if ((v = keyValue(line, "ochGetCommand"))) {
+        if (ochCmdSeen) return true;
+        ochCmdSeen = true;
+        consumeField(v, text, sizeof(text));
+        if (!compileOchCommand(text, ochCommand)) {
+            Serial.print("[INI] WARNING: can't use ochGetCommand \""); Serial.print(text);
+            Serial.print("\", using "); Serial.println(OCH_DEFAULT_COMMAND);
+            compileOchCommand(OCH_DEFAULT_COMMAND, ochCommand);
+        }
+        return true;
+    }
+    if ((v = keyValue(line, "blockingFactor"))) {
+        if (!ochCommand.blockingFactor) ochCommand.blockingFactor = (uint16_t)atoi(v);
+        return true;
+    }
+    if ((v = keyValue(line, "endianness"))) {
+        if (endianSeen) return true;
+        endianSeen = true;
+        consumeField(v, text, sizeof(text));
+        ochCommand.bigEndian = !strcmp(text, "big");
+        return true;
+    }
+    return false;
+}
+
+bool beginINI(const char* filename) {
+    Serial.print("[INI] Reading: "); Serial.println(filename);
+    iniFile = hal.fs->open(filename, FileMode::Read);
+    if (!iniFile) { Serial.println("[INI] File not found!"); return false; }
+
+    numChannels = 0; ochBlockSize = 0; numDLChannels = 0;
+    ochCommand = {};
+    compileOchCommand(OCH_DEFAULT_COMMAND, ochCommand);
+    ochCmdSeen = false; endianSeen = false;
+    exprReset();
+    iniInOCH = false; iniInDL = false; iniInSG = false;
+    ppNumSymbols = 0; ppDepth = 0; ppActive = 1; ppTaken = 0; ppSkipped = 0; sgPending = false; ppTooDeep = false;
+    return true;
+}
+
+static void parseINILine(char* line) {
+    char* sc = strchr(line, ';'); if (sc) *sc = '\0';
+    trimRight(line);
+    char* lp = line;
+    while (*lp == ' ' || *lp == '\t') lp++;
+    if (lp != line) memmove(line, lp, strlen(lp) + 1);
+    if (line[0] == '\0') return;
+    if (line[0] == '#') { ppDirective(line); return; }
+    if (!ppLive()) return;
+
+    if (line[0] == '[') {
+        iniInOCH = (strncmp(line, "[OutputChannels]", 16) == 0);
+        iniInDL  = (strncmp(line, "[Datalog]",         9) == 0);
+        iniInSG  = (strncmp(line, "[SettingGroups]",  15) == 0);
+        return;
+    }
+
+    if (iniInSG) {
+        const char* eq = strchr(line, '=');
+        if (!eq) return;
+        const char* p = eq + 1;
+        char opt[24];
+        consumeField(p, opt, sizeof(opt));
+        if (!strncmp(line, "settingGroup", 12)) sgPending = true;
+        else if (!strncmp(line, "settingOption", 13) && sgPending) {
+            sgPending = false;
+            if (strcmp(opt, "DEFAULT") != 0) ppSet(opt, true);
+        }
+        return;
+    }
+
+    if (const char* v = keyValue(line, "ochBlockSize")) {
+        if (ochBlockSize == 0) ochBlockSize = (uint16_t)atoi(v);
+        return;
+    }
+    if (parseProtocolLine(line)) return;
+
+    if (iniInOCH && numChannels < MAX_CHANNELS) {
+        Channel ch = {};
+        if (parseChannelLine(line, ch)) channels[numChannels++] = ch;
+    }
+
+    if (iniInDL && numDLChannels < MAX_CHANNELS && strncmp(line, "entry", 5) == 0) {
+        const char* eq = strchr(line, '=');
+        if (eq) {
+            const char* p = eq + 1;
+            char name[24] = {}, lbl[40] = {}, typeStr[8] = {}, fmt[16] = {};
+            consumeField(p, name,    sizeof(name));
+            consumeField(p, lbl,     sizeof(lbl));
+            consumeField(p, typeStr, sizeof(typeStr));
+            consumeField(p, fmt,     sizeof(fmt));
+            int16_t idx = findChannelByName(name);
+            if (idx >= 0) {
+                DLChannel& dl = dlChannels[numDLChannels++];
+                size_t n = strnlen(lbl, sizeof(dl.label) - 1);
+                memcpy(dl.label, lbl, n);
+                dl.label[n] = '\0';
+                dl.chanIdx = (uint16_t)idx;
+                dl.isFloat = (strcmp(typeStr, "float") == 0);
+                int8_t d = formatDigits(fmt);
+                dl.digits  = d >= 0 ? (uint8_t)d : channels[idx].digits;
+            }
+        }
+    }
+}
+
+void abortINI() {
+    if (iniFile) { hal.fs->close(iniFile); iniFile = nullptr; }
+}
+
+Step stepINI() {
+    char line[256];
+    for (uint16_t n = 0; n < INI_LINES_PER_PASS; n++) {
+        bool more = ppLive() ? readLine(iniFile, line, sizeof(line))
+                             : skipLine(iniFile, line, sizeof(line));
+        if (!more) {
+            abortINI();
+
+            Serial.print("[INI] Channels: "); Serial.print(numChannels);
+            Serial.print("  ochBlockSize: "); Serial.print(ochBlockSize);
+            Serial.print("  Datalog: "); Serial.println(numDLChannels);
+            if (ppNumSymbols || ppSkipped) {
+                Serial.print("[INI] Symbols:");
+                for (uint8_t i = 0; i < ppNumSymbols; i++) { Serial.print(' '); Serial.print(ppSymbols[i]); }
+                Serial.print("  lines skipped by #if: "); Serial.println(ppSkipped);
+            }
+            if (ppDepth) Serial.println("[INI] WARNING: #if without #endif");
+
+            if (ochBlockSize == 0)         { Serial.println("[INI] ERROR: ochBlockSize not found."); return Step::Failed; }
+            if (ochBlockSize > OCH_BUF_SIZE) {
+                Serial.print("[INI] ERROR: ochBlockSize="); Serial.print(ochBlockSize);
+                Serial.print(" > OCH_BUF_SIZE="); Serial.println(OCH_BUF_SIZE);
+                return Step::Failed;
+            }
+            if (numChannels == 0)          { Serial.println("[INI] ERROR: No scalar channels parsed."); return Step::Failed; }
+            planChunks();
+            if (ochCommand.chunk < ochBlockSize) {
+                Serial.print("[INI] blockingFactor: "); Serial.print(ochCommand.chunk);
+                Serial.print(" bytes, "); Serial.print((ochBlockSize + ochCommand.chunk - 1) / ochCommand.chunk);
+                Serial.println(" requests per block");
+            }
+            return Step::Done;
+        }
+        parseINILine(line);
+        if (ppTooDeep) {
+            abortINI();
+            Serial.println("[INI] ERROR: #if nested deeper than 31 levels.");
+            return Step::Failed;
+        }
+    }
+    return Step::Pending;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Blob decoding
+// ─────────────────────────────────────────────────────────────
+// The blob uses the INI's `endianness`, like the request fields.
+static inline uint16_t load16(const uint8_t* p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return ochCommand.bigEndian ? __builtin_bswap16(v) : v;
+}
+static inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ochCommand.bigEndian ? __builtin_bswap32(v) : v;
+}
+
+float decodeChannel(const uint8_t* blob, const Channel& ch) {
+    if (ch.dk == DK_BITS) return (float)bitsOf((uint32_t)decodeRaw(blob, ch), ch);
+    if (ch.dk == DK_EXPR) return exprEval(ch.expr, blob);
+    const uint8_t* src = blob + ch.offset;
+    float raw = 0;
+    switch (ch.tc) {
+        case TC_U08: raw = (float)src[0]; break;
+        case TC_S08: raw = (float)(int8_t)src[0]; break;
+        case TC_U16: raw = (float)load16(src); break;
+        case TC_S16: raw = (float)(int16_t)load16(src); break;
+        case TC_U32: raw = (float)load32(src); break;
+        case TC_S32: raw = (float)(int32_t)load32(src); break;
+        case TC_F32: { uint32_t v = load32(src); memcpy(&raw, &v, 4); break; }
+        default: break;
+    }
+    return raw * ch.mul + ch.add;
+}
+
+int64_t decodeRaw(const uint8_t* blob, const Channel& ch) {
+    const uint8_t* src = blob + ch.offset;
+    int64_t raw = 0;
+    switch (ch.tc) {
+        case TC_U08: raw = src[0]; break;
+        case TC_S08: raw = (int8_t)src[0]; break;
+        case TC_U16: raw = load16(src); break;
+        case TC_S16: raw = (int16_t)load16(src); break;
+        case TC_U32: raw = load32(src); break;
+        case TC_S32: raw = (int32_t)load32(src); break;
+        default: break;
+    }
+    return raw;
+}
+
+int64_t decodeFixed(const uint8_t* blob, const Channel& ch) {
+    int64_t raw = decodeRaw(blob, ch);
+    switch (ch.dk) {
+        case DK_INT:  return raw;
+        case DK_BITS: return bitsOf((uint32_t)raw, ch);
+        default:      return raw * ch.fixMul + ch.fixAdd;
+    }
+}
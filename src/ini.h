@@ -0,0 +1,104 @@
+// ============================================================
+//  ini.h — TunerStudio INI parser and channel tables
+// ============================================================
+//
+//  Reads ochBlockSize, the ochGetCommand request, [OutputChannels]
+//  scalars and the optional [Datalog] subset. Parsing is sliced: beginINI() opens the file and
+//  stepINI() handles INI_LINES_PER_PASS lines per call until Done or
+//  Failed, so a 10 000-line rusEFI INI never stalls the scheduler.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+#include "config.h"
+
+// Result of one slice of a multi-pass operation.
+enum class Step : uint8_t { Pending, Done, Failed };
+
+// ─── Channel descriptor ─────────────────────────────────────
+enum TypeCode : uint8_t {
+    TC_U08 = 0, TC_S08,
+    TC_U16,     TC_S16,
+    TC_U32,     TC_S32,
+    TC_F32,
+    TC_UNKNOWN = 0xFF
+};
+
+// How a channel's value is computed, chosen once at parse time. Integer
+// kinds are exact for every U32/S32 value and never touch the FPU.
+enum DecodeKind : uint8_t {
+    DK_INT,      // integer type, mul 1, add 0: the raw value
+    DK_FIXED,    // integer type, decimal scale: raw * fixMul + fixAdd, in 10^-fixDigits
+    DK_FLOAT,    // F32, or a scale with no short decimal form
+    DK_BITS,     // 'bits' field [bitLo, bitLo + bitWidth) of the word at offset
+    DK_EXPR      // { expression } over other channels (expr.h), float
+};
+
+// Kinds decoded to exact integers (decodeFixed) rather than float.
+inline bool isFixedKind(DecodeKind dk) { return dk == DK_INT || dk == DK_FIXED || dk == DK_BITS; }
+
+struct Channel {
+    char     name[24];
+    char     unit[12];
+    uint16_t offset;
+    TypeCode tc;
+    float    mul;
+    float    add;
+    uint8_t  digits;     // decimals shown: INI digits field, else what mul/add need
+    DecodeKind dk;
+    uint8_t  fixDigits;
+    int32_t  fixMul, fixAdd;
+    uint8_t  bitLo, bitWidth;
+    uint8_t  expr;       // DK_EXPR: id from exprCompile()
+};
+
+struct DLChannel {
+    char     label[40];
+    uint16_t chanIdx;
+    bool     isFloat;
+    uint8_t  digits;     // from the entry's format ("%.1f"), else the channel's
+};
+
+// ─── Output-channel request ─────────────────────────────────
+// ochGetCommand compiled once: literal bytes with the offset and count
+// patched in at fixed positions, in the INI's endianness. Reads longer
+// than `chunk` (blockingFactor, or what a 1-byte count can say) are
+// split into several requests.
+struct OchCommand {
+    uint8_t  bytes[OCH_CMD_MAX];
+    uint8_t  len;
+    uint8_t  offPos, offWidth;   // %No: width 0 = no offset field
+    uint8_t  cntPos, cntWidth;   // %Nc
+    bool     bigEndian;
+    uint16_t blockingFactor;     // from the INI, 0 = none
+    uint16_t chunk;              // max bytes per request
+    bool ranged() const { return offWidth && cntWidth; }   // can read part of the block
+};
+
+class FileHandle;
+
+// ─── Channel table ──────────────────────────────────────────
+extern Channel   channels[MAX_CHANNELS];
+extern uint16_t  numChannels;
+extern uint16_t  ochBlockSize;
+extern OchCommand ochCommand;
+
+extern DLChannel dlChannels[MAX_CHANNELS];
+extern uint16_t  numDLChannels;
+
+bool    beginINI(const char* filename);
+Step    stepINI();
+void    abortINI();
+int16_t findChannelByName(const char* name);
+uint8_t ochRequest(uint16_t offset, uint16_t count, uint8_t* out);   // command payload, returns its length
+void    sigToFilename(const char* sig, char* out, size_t outLen);
+void    trimRight(char* s);
+bool    readLine(FileHandle* f, char* buf, size_t maxLen);   // false at EOF
+float   decodeChannel(const uint8_t* blob, const Channel& ch); // raw * mul + add
+int64_t decodeFixed(const uint8_t* blob, const Channel& ch);   // DK_INT / DK_FIXED / DK_BITS, in 10^-fixDigits
+int64_t decodeRaw(const uint8_t* blob, const Channel& ch);     // the integer at offset, unscaled
+// A DK_BITS field from an already loaded word, so flags that share a
+// word cost one load.
+inline uint32_t bitsOf(uint32_t word, const Channel& ch) {
+    return (word >> ch.bitLo) & (0xFFFFFFFFu >> (32 - ch.bitWidth));
+}
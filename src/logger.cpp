@@ -0,0 +1,1434 @@
+// ============================================================
+//  logger.cpp — ECU handshake, polling and MSL logging
+// ============================================================
+#include "logger.h"
+#include "buffers.h"
+#include "crc32.h"
+#include "hal.h"
+#include "prof.h"
+#include "rates.h"
+#include "scheduler.h"
+#include "sdbench.h"
+#include "sparse.h"
+#include "tables.h"
+#include "telem.h"
+#include <float.h>
+#include <math.h>
+
+// ─── SD ─────────────────────────────────────────────────────
+static FileHandle* logFile = nullptr;
+
+// Rows are formatted into rowLine, appended whole to sdRing by the ECU
+// task and written to the card by the SD drain task in slack time, so a
+// slow card write never lands between an 'O' request and its reply.
+DMAMEM static uint8_t sdRingBuf[SD_RING_SIZE];
+static ByteRing   sdRing = { sdRingBuf, SD_RING_SIZE };
+static LineBuffer<ROW_BUF_SIZE> rowLine;
+static uint32_t   rowsDropped = 0;   // rows lost because sdRing was full (or the card failed)
+static uint32_t   writeErrors = 0;   // short or failed card writes
+static uint32_t   writeErrorReportMs = 0;
+
+// ─── Sync policy ────────────────────────────────────────────
+// The file is synced (size + directory entry) when the drain lands on
+// the syncClusters-th cluster boundary since the last sync, or when
+// unsynced data is syncIntervalMs old — whichever comes first. Drains
+// never straddle a boundary, so cluster syncs fall exactly on one.
+// Between syncs only data sectors are written; with a pre-allocated
+// file there is no FAT traffic either.
+static constexpr uint32_t FALLBACK_CLUSTER_BYTES = 32768;
+
+uint32_t          syncClusters   = SYNC_CLUSTERS;
+static uint32_t   clusterBytes   = FALLBACK_CLUSTER_BYTES;
+static uint64_t   logBytes       = 0;   // bytes handed to the file
+static uint64_t   syncedBytes    = 0;   // logBytes at the last sync
+static bool       unsynced       = false;
+static uint32_t   unsyncedSinceMs = 0;  // first row appended after the last sync
+static uint32_t   syncsCluster = 0, syncsAge = 0;
+static uint32_t   dirUpdates = 0;   // syncs that moved the size, i.e. rewrote the directory entry
+static uint32_t   flushMaxUs = 0;
+static uint64_t   flushSumUs = 0;
+static uint32_t   lossMaxMs = 0, lossMaxBytes = 0;   // worst exposure seen at a sync
+
+// ─── Logger health (HEALTH_CHANNELS) ────────────────────────
+// Cumulative per log file; written as extra columns so MegaLogViewer
+// shows exactly when and why the logger fell behind.
+static uint32_t pollFails    = 0;   // no reply, short/bad frame or CRC mismatch
+static uint32_t crcErrors    = 0;   // reply CRC mismatches (subset of pollFails)
+static uint32_t ochSentUs    = 0;   // micros() when the current 'O' went out
+static uint32_t sampleDtUs   = 0;   // send-to-send time of the last two good samples
+static uint32_t lastSampleUs = 0;
+static uint32_t ecuRttUs     = 0;   // request → reply complete of the current sample
+static uint32_t sdLatencyUs  = 0;   // duration of the most recent SD write or flush
+
+// sparseBand: change that counts as new in sparse mode; timings jitter
+// every row, so small moves are not worth a value each.
+struct HealthColumn { const char* name; const char* unit; float sparseBand; };
+static constexpr HealthColumn HEALTH_COLUMNS[] = {
+    { "Log Sample dt",    "us", 1000 },
+    { "Log ECU RTT",      "us", 1000 },
+    { "Log SD latency",   "us", 1000 },
+    { "Log Buffer fill",  "%",  5    },
+    { "Log Poll fails",   "",   0    },
+    { "Log Rows dropped", "",   0    },
+    { "Log CRC errors",   "",   0    },
+};
+static constexpr uint8_t HEALTH_COUNT = sizeof(HEALTH_COLUMNS) / sizeof(HEALTH_COLUMNS[0]);
+
+// ─── Session catalog ────────────────────────────────────────
+// One CSV line per log, appended on close, so a card full of sessions
+// can be browsed by reading one small file (tools/catalog rebuilds it).
+static const char* const CATALOG_FILE = "CATALOG.CSV";
+static char     logPath[48]   = {};
+static char     logStartText[32] = {};   // RTC time at open, "" if unset (sized for any field values)
+static uint32_t rowsWritten   = 0;
+static int16_t  catalogChan[CATALOG_KEY_COUNT];   // channel index, -1 if absent
+static float    catalogMin[CATALOG_KEY_COUNT], catalogMax[CATALOG_KEY_COUNT];
+
+// ─── Session statistics ─────────────────────────────────────
+// Welford running mean/variance per logged column plus time spent
+// above each SUMMARY_LIMITS entry, written as <log>.sum on close.
+static float    statMin[MAX_CHANNELS], statMax[MAX_CHANNELS];
+static double   statMean[MAX_CHANNELS], statM2[MAX_CHANNELS];
+static uint32_t statCount  = 0;   // rows folded in (every column sees every row)
+static uint32_t statLastMs = 0;
+static int16_t  limitCol[SUMMARY_LIMIT_COUNT];   // logged column, -1 if not logged
+static bool     limitAbove[SUMMARY_LIMIT_COUNT];
+static uint32_t limitMs[SUMMARY_LIMIT_COUNT];
+
+// ─── Decoded row ────────────────────────────────────────────
+// Per-sample context that travels with a blob through the black-box ring.
+struct SampleHdr {
+    uint32_t ms;      // receive time
+    uint32_t dtUs;    // since the previous 'O' request
+    uint32_t rttUs;   // request → complete reply
+};
+static uint8_t  ochBuffer[OCH_BUF_SIZE];
+static float    rowValues[MAX_CHANNELS + HEALTH_COUNT];   // decoded values of the current row
+static int64_t  rowFixed[MAX_CHANNELS + HEALTH_COUNT];    // exact values of isFixedKind() columns, in 10^-fixDigits
+
+// ─── State vars ─────────────────────────────────────────────
+bool            rtcOK        = false;
+uint32_t        pollIntervalMs = POLL_INTERVAL_MS;
+uint32_t        syncIntervalMs = SYNC_INTERVAL_MS;
+bool            sparseLog      = SPARSE_LOG;
+static State    state        = State::WaitDevice;
+static uint32_t stateEnterMs = 0;
+static bool     ochPending   = false;  // 'O' sent, response still arriving
+static uint32_t logStartMs   = 0;
+static bool     logOpen      = false;
+static uint32_t logsClosed   = 0;
+static char     signature[64]   = {};
+static char     iniFilename[13] = {};
+static char     fResponse[8]    = {};
+
+// ─────────────────────────────────────────────────────────────
+//  LED
+// ─────────────────────────────────────────────────────────────
+struct LedPattern { uint16_t onMs; uint16_t offMs; };
+constexpr LedPattern PAT_WAIT    = {500, 500};
+constexpr LedPattern PAT_CONNECT = {100, 100};
+constexpr LedPattern PAT_LOG     = { 50, 950};
+constexpr LedPattern PAT_ARMED   = { 50, 2950};  // black-box / auto session, waiting to start
+constexpr LedPattern PAT_MTP     = {200, 200};
+constexpr LedPattern PAT_ERROR   = {  0,   0};  // solid on
+
+static const LedPattern* ledPat   = &PAT_WAIT;
+static uint32_t          ledTimer = 0;
+static bool              ledOn    = false;
+
+static void setLED(const LedPattern* p) { ledPat = p; ledTimer = halMillis(); }
+
+void loggerLedTask() {
+    if (!hal.led) return;
+    if (!ledPat->onMs && !ledPat->offMs) { hal.led(true); return; }
+    uint32_t period = ledOn ? ledPat->onMs : ledPat->offMs;
+    if ((uint32_t)(halMillis() - ledTimer) >= period) {
+        ledOn = !ledOn;
+        hal.led(ledOn);
+        ledTimer = halMillis();
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  RTC helpers
+// ─────────────────────────────────────────────────────────────
+// Parse __DATE__ / __TIME__ compiler macros into a time_t.
+uint32_t compileTime() {
+    const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char ms[4] = { __DATE__[0], __DATE__[1], __DATE__[2], '\0' };
+    DateTime dt;
+    dt.month  = (strstr(months, ms) - months) / 3 + 1;
+    dt.day    = atoi(__DATE__ + 4);
+    dt.year   = atoi(__DATE__ + 7);
+    dt.hour   = atoi(__TIME__ + 0);
+    dt.minute = atoi(__TIME__ + 3);
+    dt.second = atoi(__TIME__ + 6);
+    return fromDateTime(dt);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Log file management
+// ─────────────────────────────────────────────────────────────
+// ─── Log naming ─────────────────────────────────────────────
+// Each name costs one exists() probe in the normal case. Sequential
+// names come from a counter persisted in LOG_INDEX_FILE (rebuilt by
+// probing once if the file is missing); timestamp collisions within a
+// minute continue from the last suffix used. Neither has an upper cap.
+static const char* const LOG_INDEX_FILE = "LOGINDEX.TXT";
+static uint32_t nextLogIndex   = 0;    // 0 = not loaded from the card yet
+static char     lastFolder[16] = {};   // folder known to exist
+static char     lastBase[32]   = {};   // "folder/base" of the last timestamped log
+static uint16_t lastSuffix     = 0;
+
+static uint32_t loadLogIndex() {
+    FileHandle* f = hal.fs->open(LOG_INDEX_FILE, FileMode::Read);
+    if (!f) return 0;
+    char buf[12];
+    int n = f->read(buf, sizeof(buf) - 1);
+    hal.fs->close(f);
+    buf[n > 0 ? n : 0] = '\0';
+    return (uint32_t)strtoul(buf, nullptr, 10);
+}
+
+static void saveLogIndex(uint32_t next) {
+    FileHandle* f = hal.fs->open(LOG_INDEX_FILE, FileMode::Overwrite);
+    if (!f) { Serial.print("[SD] Cannot write "); Serial.println(LOG_INDEX_FILE); return; }
+    f->println(next);
+    hal.fs->close(f);
+}
+
+static const char* logExt() { return sparseLog ? ".tsb" : ".msl"; }
+
+static bool openNextLogFile() {
+    char name[48];
+
+    if (rtcOK) {
+        DateTime t;
+        toDateTime(hal.rtc->get(), t);
+        static const char* const mo[] = {
+            "", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+        int h = t.hour;
+        const char* ampm = (h < 12) ? "am" : "pm";
+        int h12 = h % 12; if (h12 == 0) h12 = 12;
+
+        char folder[16];
+        snprintf(folder, sizeof(folder), "%s %d %04d", mo[t.month], t.day, t.year);
+        if (strcmp(folder, lastFolder) != 0) {
+            if (!hal.fs->exists(folder) && !hal.fs->mkdir(folder)) {
+                Serial.print("[SD] Cannot create folder "); Serial.println(folder);
+                return false;
+            }
+            strcpy(lastFolder, folder);
+        }
+
+        char base[32];
+        snprintf(base, sizeof(base), "%s/%02d%02d%s %s %d", folder, h12, t.minute, ampm, mo[t.month], t.day);
+        uint16_t suffix = strcmp(base, lastBase) == 0 ? lastSuffix + 1 : 0;
+        for (;;) {
+            if (suffix == 0) snprintf(name, sizeof(name), "%s%s", base, logExt());
+            else             snprintf(name, sizeof(name), "%s_%02u%s", base, suffix, logExt());
+            if (!hal.fs->exists(name)) break;
+            suffix++;
+        }
+        strcpy(lastBase, base);
+        lastSuffix = suffix;
+    } else {
+        if (nextLogIndex == 0) nextLogIndex = max(loadLogIndex(), (uint32_t)1);
+        // One probe unless the index is stale (logs copied in, index deleted).
+        for (;;) {
+            snprintf(name, sizeof(name), "LOG%03lu%s", (unsigned long)nextLogIndex, logExt());
+            if (!hal.fs->exists(name)) break;
+            nextLogIndex++;
+        }
+    }
+
+    logFile = hal.fs->open(name, FileMode::Append);
+    if (!logFile) {
+        Serial.print("[SD] Cannot create "); Serial.println(name);
+        return false;
+    }
+    if (!rtcOK) saveLogIndex(++nextLogIndex);
+    strcpy(logPath, name);
+    Serial.print("[SD] Log: "); Serial.println(name);
+    return true;
+}
+
+static void writeHeader() {
+    if (sparseLog) sparseWriteHeader(*logFile);
+    // TunerStudio-style preamble; MegaLogViewer skips quoted lines.
+    logFile->print('"'); logFile->print(signature); logFile->println('"');
+    if (logStartText[0]) {
+        logFile->print("\"Capture Date: "); logFile->print(logStartText); logFile->println('"');
+    }
+    logFile->print("Time");
+    if (numDLChannels > 0) {
+        for (uint16_t i = 0; i < numDLChannels; i++) {
+            logFile->print('\t'); logFile->print(dlChannels[i].label);
+        }
+    } else {
+        for (uint16_t i = 0; i < numChannels; i++) {
+            logFile->print('\t'); logFile->print(channels[i].name);
+        }
+    }
+    if (HEALTH_CHANNELS)
+        for (const HealthColumn& hc : HEALTH_COLUMNS) { logFile->print('\t'); logFile->print(hc.name); }
+    logFile->println();
+    logFile->print("s");
+    if (numDLChannels > 0) {
+        for (uint16_t i = 0; i < numDLChannels; i++) {
+            logFile->print('\t'); logFile->print(channels[dlChannels[i].chanIdx].unit);
+        }
+    } else {
+        for (uint16_t i = 0; i < numChannels; i++) {
+            logFile->print('\t'); logFile->print(channels[i].unit);
+        }
+    }
+    if (HEALTH_CHANNELS)
+        for (const HealthColumn& hc : HEALTH_COLUMNS) { logFile->print('\t'); logFile->print(hc.unit); }
+    logFile->println();
+    if (sparseLog) logFile->write((uint8_t)0);   // end of the text header
+    logFile->flush();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Session catalog and statistics
+// ─────────────────────────────────────────────────────────────
+static void catalogBegin() {
+    rowsWritten = 0;
+    for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+        catalogChan[k] = findChannelByName(CATALOG_KEYS[k]);
+        catalogMin[k] = catalogMax[k] = 0;
+    }
+}
+
+static void catalogRow(const uint8_t* blob) {
+    for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+        if (catalogChan[k] < 0) continue;
+        float v = decodeChannel(blob, channels[catalogChan[k]]);
+        if (rowsWritten == 0 || v < catalogMin[k]) catalogMin[k] = v;
+        if (rowsWritten == 0 || v > catalogMax[k]) catalogMax[k] = v;
+    }
+    rowsWritten++;
+}
+
+static void printCsvQuoted(Print& p, const char* s) {
+    p.print('"');
+    for (; *s; s++) { if (*s == '"') p.print('"'); p.print(*s); }
+    p.print('"');
+}
+
+// Append this log's line to CATALOG_FILE (header first on a new file).
+static void catalogAppend() {
+    FileHandle* f = hal.fs->open(CATALOG_FILE, FileMode::Append);
+    if (!f) { Serial.print("[SD]  Cannot update "); Serial.println(CATALOG_FILE); return; }
+    if (f->size() == 0) {
+        f->print("path,start,duration_s,rows,signature");
+        for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+            f->print(','); f->print(CATALOG_KEYS[k]); f->print("_min");
+            f->print(','); f->print(CATALOG_KEYS[k]); f->print("_max");
+        }
+        f->println();
+    }
+    printCsvQuoted(*f, logPath);
+    f->print(','); f->print(logStartText);
+    f->print(','); f->print((halMillis() - logStartMs) / 1000.0f, 1);
+    f->print(','); f->print(rowsWritten);
+    f->print(','); printCsvQuoted(*f, signature);
+    for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+        f->print(',');
+        if (catalogChan[k] >= 0 && rowsWritten) f->print(catalogMin[k], 2);
+        f->print(',');
+        if (catalogChan[k] >= 0 && rowsWritten) f->print(catalogMax[k], 2);
+    }
+    f->println();
+    hal.fs->close(f);
+}
+
+static uint16_t logColumns() { return numDLChannels > 0 ? numDLChannels : numChannels; }
+
+static void statsBegin() {
+    statCount = 0;
+    for (uint16_t i = 0; i < logColumns(); i++) {
+        statMin[i] = FLT_MAX; statMax[i] = -FLT_MAX;
+        statMean[i] = statM2[i] = 0;
+    }
+    for (uint8_t k = 0; k < SUMMARY_LIMIT_COUNT; k++) {
+        int16_t ch = findChannelByName(SUMMARY_LIMITS[k].name);
+        limitCol[k] = -1;
+        limitAbove[k] = false;
+        limitMs[k] = 0;
+        if (ch < 0) continue;
+        if (numDLChannels == 0) { limitCol[k] = ch; continue; }
+        for (uint16_t i = 0; i < numDLChannels; i++)
+            if (dlChannels[i].chanIdx == (uint16_t)ch) { limitCol[k] = i; break; }
+    }
+}
+
+// Fold the row in rowValues[] into the running stats. One division per
+// row, then a multiply-add per column.
+static void statsRow(uint16_t count, uint32_t nowMs) {
+    statCount++;
+    double inv = 1.0 / statCount;
+    for (uint16_t i = 0; i < count; i++) {
+        float x = rowValues[i];
+        if (x < statMin[i]) statMin[i] = x;
+        if (x > statMax[i]) statMax[i] = x;
+        double d = x - statMean[i];
+        statMean[i] += d * inv;
+        statM2[i]   += d * (x - statMean[i]);
+    }
+    // A sample holds until the next row, so the interval counts as above
+    // when the row that started it was.
+    for (uint8_t k = 0; k < SUMMARY_LIMIT_COUNT; k++) {
+        if (limitCol[k] < 0) continue;
+        if (limitAbove[k]) limitMs[k] += nowMs - statLastMs;
+        limitAbove[k] = rowValues[limitCol[k]] > SUMMARY_LIMITS[k].limit;
+    }
+    statLastMs = nowMs;
+}
+
+// Write <log>.sum: one CSV line per logged column.
+static void statsWrite() {
+    char path[sizeof(logPath)];
+    strcpy(path, logPath);
+    char* dot = strrchr(path, '.');
+    if (!dot) return;
+    strcpy(dot, ".sum");
+    FileHandle* f = hal.fs->open(path, FileMode::Overwrite);
+    if (!f) { Serial.print("[SD]  Cannot write "); Serial.println(path); return; }
+
+    f->println("channel,unit,count,min,max,mean,stddev,limit,above_s");
+    for (uint16_t i = 0; i < logColumns(); i++) {
+        const Channel& ch = numDLChannels > 0 ? channels[dlChannels[i].chanIdx] : channels[i];
+        printCsvQuoted(*f, numDLChannels > 0 ? dlChannels[i].label : ch.name);
+        f->print(','); printCsvQuoted(*f, ch.unit);
+        f->print(','); f->print(statCount);
+        f->print(',');
+        if (statCount) f->print(statMin[i], 3);
+        f->print(',');
+        if (statCount) f->print(statMax[i], 3);
+        f->print(',');
+        if (statCount) f->print(statMean[i], 3);
+        f->print(',');
+        if (statCount > 1) f->print(sqrt(statM2[i] / (statCount - 1)), 3);
+        uint8_t k = 0;
+        while (k < SUMMARY_LIMIT_COUNT && limitCol[k] != (int16_t)i) k++;
+        if (k < SUMMARY_LIMIT_COUNT) {
+            f->print(','); f->print(SUMMARY_LIMITS[k].limit, 3);
+            f->print(','); f->print(limitMs[k] / 1000.0f, 3);
+        } else {
+            f->print(",,");
+        }
+        f->println();
+    }
+    hal.fs->close(f);
+}
+
+static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+static const float    INV_POW10[] = { 1.0f, 0.1f, 0.01f, 0.001f, 1e-4f, 1e-5f, 1e-6f, 1e-7f };
+
+// v in units of 10^-from, printed with `to` decimals, rounding half away
+// from zero. Integer math only, so the text is exact at any magnitude.
+static void printFixed(Print& out, int64_t v, uint8_t from, uint8_t to) {
+    if (from > to) { int64_t d = POW10[from - to]; v = (v + (v < 0 ? -d / 2 : d / 2)) / d; }
+    else           v *= POW10[to - from];
+    char buf[24], *p = buf + sizeof(buf);
+    *--p = '\0';
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    uint8_t n = 0;
+    do {
+        if (n == to && n) *--p = '.';
+        uint32_t digit;
+        if (u > UINT32_MAX) { digit = (uint32_t)(u % 10); u /= 10; }
+        else                { uint32_t s = (uint32_t)u; digit = s % 10; u = s / 10; }
+        *--p = (char)('0' + digit);
+        n++;
+    } while (u || n <= to);
+    if (v < 0) *--p = '-';
+    out.print(p);
+}
+
+// Decode and format are separate passes so each can be timed on its own
+// and later consumers can read rowValues[] without re-decoding.
+static void writeRow(const SampleHdr& h, const uint8_t* blob) {
+    uint16_t count = logColumns();
+
+    PROF_BEGIN(tDecode);
+    int32_t  wordOffset = -1;   // last word loaded for DK_BITS
+    TypeCode wordTc     = TC_UNKNOWN;
+    uint32_t word       = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const Channel& ch = numDLChannels > 0
+            ? channels[dlChannels[i].chanIdx] : channels[i];
+        if (!isFixedKind(ch.dk)) {
+            rowValues[i] = decodeChannel(blob, ch);
+        } else if (ch.dk == DK_BITS) {
+            // INI flags of one word sit next to each other: one load for the run.
+            if (ch.offset != wordOffset || ch.tc != wordTc) {
+                wordOffset = ch.offset; wordTc = ch.tc;
+                word = (uint32_t)decodeRaw(blob, ch);
+            }
+            rowFixed[i]  = bitsOf(word, ch);
+            rowValues[i] = (float)rowFixed[i];
+        } else {
+            rowFixed[i]  = decodeFixed(blob, ch);
+            rowValues[i] = (float)rowFixed[i] * INV_POW10[ch.fixDigits];
+        }
+    }
+    PROF_END(PS_DECODE, tDecode);
+
+    PROF_BEGIN(tFormat);
+    rowLine.clear();
+    if (sparseLog) {
+        if (HEALTH_CHANNELS) {
+            const uint32_t health[HEALTH_COUNT] = {
+                h.dtUs, h.rttUs, sdLatencyUs, (uint32_t)((uint64_t)sdRing.used() * 100 / SD_RING_SIZE),
+                pollFails, rowsDropped, crcErrors,
+            };
+            for (uint8_t k = 0; k < HEALTH_COUNT; k++) rowFixed[count + k] = health[k];
+        }
+        sparseEncode(rowLine, h.ms - logStartMs, rowValues, rowFixed);
+    } else {
+        char buf[20];
+        printFixed(rowLine, h.ms - logStartMs, 3, 3);
+        for (uint16_t i = 0; i < count; i++) {
+            const Channel& ch = numDLChannels > 0 ? channels[dlChannels[i].chanIdx] : channels[i];
+            bool    asFloat = numDLChannels > 0 ? dlChannels[i].isFloat : true;
+            uint8_t digits  = numDLChannels > 0 ? dlChannels[i].digits  : ch.digits;
+            rowLine.print('\t');
+            if (isFixedKind(ch.dk)) {
+                if (asFloat) printFixed(rowLine, rowFixed[i], ch.fixDigits, digits);
+                else         rowLine.print(ch.fixDigits ? rowFixed[i] / (int64_t)POW10[ch.fixDigits] : rowFixed[i]);
+            }
+            else if (asFloat && digits) { dtostrf(rowValues[i], 1, digits, buf); rowLine.print(buf); }
+            else if (asFloat)           { rowLine.print((int32_t)lroundf(rowValues[i])); }
+            else                        { rowLine.print((int32_t)rowValues[i]); }
+        }
+        if (HEALTH_CHANNELS) {
+            rowLine.print('\t'); rowLine.print(h.dtUs);
+            rowLine.print('\t'); rowLine.print(h.rttUs);
+            rowLine.print('\t'); rowLine.print(sdLatencyUs);
+            rowLine.print('\t'); rowLine.print((uint32_t)((uint64_t)sdRing.used() * 100 / SD_RING_SIZE));
+            rowLine.print('\t'); rowLine.print(pollFails);
+            rowLine.print('\t'); rowLine.print(rowsDropped);
+            rowLine.print('\t'); rowLine.print(crcErrors);
+        }
+        rowLine.println();
+    }
+    PROF_END(PS_FORMAT, tFormat);
+
+    PROF_BEGIN(tAppend);
+    if (rowLine.overflowed() || !sdRing.push(rowLine.data(), rowLine.length())) {
+        rowsDropped++;
+    } else {
+        if (sparseLog) sparseCommit();
+        if (!unsynced) { unsynced = true; unsyncedSinceMs = halMillis(); }
+        catalogRow(blob);
+        if (SUMMARY_SIDECAR) statsRow(count, h.ms);
+        tablesRow(blob);
+    }
+    PROF_END(PS_APPEND, tAppend);
+}
+
+// Hand at most SD_CHUNK staged bytes to the card, stopping at the next
+// cluster boundary when cluster syncs are on. Only what the card took
+// leaves the ring; the rest is retried next pass, and a card that keeps
+// failing fills the ring, so new rows are counted as dropped. Returns
+// bytes written.
+static uint32_t drainRing() {
+    const uint8_t* p;
+    uint32_t n = min(sdRing.peek(p), (uint32_t)SD_CHUNK);
+    if (syncClusters) n = min(n, (uint32_t)(clusterBytes - logBytes % clusterBytes));
+    if (n == 0) return 0;
+    PROF_BEGIN(tWrite);
+    uint32_t t0 = halMicros();
+    size_t w = logFile->write(p, n);
+    sdLatencyUs = halMicros() - t0;
+    PROF_END(PS_SD_WRITE, tWrite);
+    sdRing.pop((uint32_t)w);
+    logBytes += w;
+    if (w < n) {
+        writeErrors++;
+        if (halMillis() - writeErrorReportMs >= 1000) {
+            Serial.print("[SD] Write error: "); Serial.print((uint32_t)w); Serial.print(" of ");
+            Serial.print(n); Serial.print(" bytes  (total "); Serial.print(writeErrors); Serial.println(")");
+            writeErrorReportMs = halMillis();
+        }
+    }
+    return (uint32_t)w;
+}
+
+// Rows the card would not take before the log closed. MSL rows are
+// counted by their newlines; .tsb records are binary, so only bytes.
+static void dropStaged() {
+    uint32_t bytes = sdRing.used(), rows = 0;
+    while (sdRing.used() > 0) {
+        const uint8_t* p;
+        uint32_t n = sdRing.peek(p);
+        if (!sparseLog) for (uint32_t i = 0; i < n; i++) rows += p[i] == '\n';
+        sdRing.pop(n);
+    }
+    rowsDropped += rows;
+    Serial.print("[SD] Card write failed at close — "); Serial.print(bytes);
+    Serial.print(" staged bytes lost");
+    if (!sparseLog) { Serial.print(" ("); Serial.print(rows); Serial.print(" rows)"); }
+    Serial.println();
+}
+
+static void syncLog(bool onCluster) {
+    PROF_BEGIN(tFlush);
+    uint32_t now = halMillis();
+    uint32_t t0  = halMicros();
+    logFile->flush();
+    uint32_t us = halMicros() - t0;
+    PROF_END(PS_FLUSH, tFlush);
+
+    sdLatencyUs = us;
+    flushSumUs += us;
+    if (us > flushMaxUs) flushMaxUs = us;
+    if (onCluster) syncsCluster++; else syncsAge++;
+    if (logBytes != syncedBytes) dirUpdates++;
+
+    uint32_t lossBytes = (uint32_t)(logBytes - syncedBytes) + sdRing.used();
+    if (lossBytes > lossMaxBytes) lossMaxBytes = lossBytes;
+    if (unsynced && now - unsyncedSinceMs > lossMaxMs) lossMaxMs = now - unsyncedSinceMs;
+    // Rows still staged are not covered by this sync; count them from now.
+    unsynced        = sdRing.used() > 0;
+    unsyncedSinceMs = now;
+    syncedBytes     = logBytes;
+}
+
+static void printSyncStats() {
+    uint32_t syncs = syncsCluster + syncsAge;
+    Serial.print("[SYNC] "); Serial.print(syncsCluster); Serial.print(" cluster + ");
+    Serial.print(syncsAge); Serial.print(" age syncs, flush mean ");
+    Serial.print(syncs ? (uint32_t)(flushSumUs / syncs) : 0); Serial.print(" us max ");
+    Serial.print(flushMaxUs); Serial.print(" us, "); Serial.print(dirUpdates);
+    Serial.print(" dir entry updates, loss window max ");
+    Serial.print(lossMaxMs); Serial.print(" ms / "); Serial.print(lossMaxBytes);
+    Serial.print(" B (cluster "); Serial.print(clusterBytes); Serial.print(" B every ");
+    Serial.print(syncClusters); Serial.print(", max age "); Serial.print(syncIntervalMs);
+    Serial.println(" ms)");
+}
+
+// ─── Closing ────────────────────────────────────────────────
+// A finished capture or session is closed by the SD drain task, one
+// card operation per pass like the drain itself: the rest of the ring,
+// then truncate + sync, then each sidecar. Polling carries on meanwhile.
+// The log counts as active (hidden from MTP) until the last step.
+enum class CloseStep : uint8_t { None, Drain, Truncate, Catalog, Summary, Tables };
+static CloseStep closing = CloseStep::None;
+
+static void closeStep() {
+    switch (closing) {
+    case CloseStep::None:
+        return;
+    case CloseStep::Drain:
+        if (sdRing.used() == 0)     closing = CloseStep::Truncate;
+        else if (drainRing() == 0)  dropStaged();   // card gave up; next pass truncates
+        return;
+    case CloseStep::Truncate:
+        logFile->truncate();   // release the unused pre-allocation
+        logFile->flush();
+        printSyncStats();
+        hal.fs->close(logFile);
+        logFile = nullptr;
+        sdRing.reset();
+        closing = CloseStep::Catalog;
+        return;
+    case CloseStep::Catalog:
+        catalogAppend();
+        closing = CloseStep::Summary;
+        return;
+    case CloseStep::Summary:
+        if (SUMMARY_SIDECAR) statsWrite();
+        closing = CloseStep::Tables;
+        return;
+    case CloseStep::Tables:
+        tablesWrite(logPath);
+        logsClosed++;
+        closing = CloseStep::None;
+        return;
+    }
+}
+
+// Stop writing rows to the log; the drain task closes it from here.
+static void beginClose() {
+    if (!logOpen) return;
+    logOpen = false;
+    closing = CloseStep::Drain;
+}
+
+static void finishClose() {
+    while (closing != CloseStep::None) closeStep();
+}
+
+// Synchronous close — on stop and disconnect, where polling ends anyway.
+static void closeLog() {
+    beginClose();
+    finishClose();
+}
+
+// Files the host has open for writing over MTP (see loggerHostWrite()).
+// No log opens while one is, so the card is never written from both sides.
+static uint8_t  hostWriters   = 0;
+static uint32_t hostWaitMsgMs = 0;
+
+void loggerHostWrite(bool open) {
+    if (open) hostWriters++;
+    else if (hostWriters) hostWriters--;
+}
+
+// True while an upload is open; says so at most once a second.
+static bool hostWriting(const char* tag) {
+    if (!hostWriters) return false;
+    if (halMillis() - hostWaitMsgMs >= 1000) {
+        hostWaitMsgMs = halMillis();
+        Serial.print(tag); Serial.println(" Host is writing to the card — log not opened.");
+    }
+    return true;
+}
+
+// Open the next log and write its header. startMs is Time 0 — the
+// oldest buffered sample for a black-box capture. Only called once the
+// previous log's staged close has finished.
+static bool openLog(uint32_t startMs) {
+    if (!openNextLogFile()) return false;
+    logStartMs = startMs;
+    sdRing.reset();
+    rowsDropped = 0;
+    writeErrors = 0;
+    clusterBytes = hal.fs->clusterBytes();
+    if (clusterBytes == 0) clusterBytes = FALLBACK_CLUSTER_BYTES;
+    if (LOG_PREALLOC_BYTES && !logFile->preAllocate(LOG_PREALLOC_BYTES))
+        Serial.println("[SD]  Pre-allocation unavailable — file grows per cluster.");
+    syncsCluster = syncsAge = 0;
+    dirUpdates = 0;
+    flushMaxUs = 0; flushSumUs = 0;
+    lossMaxMs = lossMaxBytes = 0;
+    unsynced = false;
+    logStartText[0] = '\0';
+    if (rtcOK) {
+        DateTime t;
+        toDateTime(hal.rtc->get(), t);
+        snprintf(logStartText, sizeof(logStartText), "%04d-%02d-%02d %02d:%02d:%02d",
+            t.year, t.month, t.day, t.hour, t.minute, t.second);
+    }
+    catalogBegin();
+    statsBegin();
+    tablesBegin();
+    if (sparseLog) {
+        uint16_t cols = logColumns();
+        sparseBegin(cols, cols + (HEALTH_CHANNELS ? HEALTH_COUNT : 0));
+        if (HEALTH_CHANNELS)
+            for (uint8_t k = 0; k < HEALTH_COUNT; k++) sparseColumn(cols + k, HEALTH_COLUMNS[k].sparseBand);
+    }
+    writeHeader();
+    logBytes = syncedBytes = logFile->position();
+    logOpen  = true;
+    return true;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Channel conditions
+// ─────────────────────────────────────────────────────────────
+// A Trigger list from config.h resolved against the INI channel table.
+// Every condition is evaluated on every sample so Rises always compares
+// with the previous one.
+static constexpr uint8_t MAX_CONDS = 8;
+
+struct CondSet {
+    const Trigger* conds;
+    uint8_t        count;
+    int16_t        chan[MAX_CONDS] = {};
+    float          prev[MAX_CONDS] = {};
+    bool           prevValid = false;
+    uint8_t        resolved  = 0;   // conditions whose channel is in the INI
+    uint8_t        held      = 0;   // of those, how many held on the last sample
+};
+
+static void condBegin(CondSet& cs, const char* tag) {
+    cs.prevValid = false;
+    cs.resolved = cs.held = 0;
+    for (uint8_t k = 0; k < cs.count; k++) {
+        cs.chan[k] = findChannelByName(cs.conds[k].channel);
+        if (cs.chan[k] >= 0) { cs.resolved++; continue; }
+        Serial.print(tag); Serial.print(" Channel not in INI: "); Serial.println(cs.conds[k].channel);
+    }
+}
+
+// Name of the first condition that holds on this blob, or nullptr.
+static const char* condEval(CondSet& cs, const uint8_t* blob) {
+    const char* first = nullptr;
+    cs.held = 0;
+    for (uint8_t k = 0; k < cs.count; k++) {
+        if (cs.chan[k] < 0) continue;
+        const Trigger& c = cs.conds[k];
+        float v = decodeChannel(blob, channels[cs.chan[k]]);
+        bool hit = false;
+        switch (c.op) {
+            case TrigOp::Above: hit = v > c.level; break;
+            case TrigOp::Below: hit = v < c.level; break;
+            case TrigOp::Rises: hit = cs.prevValid && v > cs.prev[k]; break;
+        }
+        cs.prev[k] = v;
+        if (!hit) continue;
+        cs.held++;
+        if (!first) first = c.channel;
+    }
+    cs.prevValid = true;
+    return first;
+}
+
+static bool condAllHeld(const CondSet& cs) { return cs.resolved && cs.held == cs.resolved; }
+
+// ─────────────────────────────────────────────────────────────
+//  Black-box capture
+// ─────────────────────────────────────────────────────────────
+// While armed, raw samples go into bbRing and only the last
+// PRETRIGGER_MS are kept; nothing touches the card. A trigger opens a
+// log, raises the poll rate to TRIGGER_POLL_MS and keeps every sample
+// until POSTTRIGGER_MS after the last trigger. blackboxStep() formats
+// the ring oldest-first into the log, so the pre-trigger history lands
+// ahead of the live rows.
+bool blackboxMode = BLACKBOX_MODE;
+
+#ifdef BLACKBOX_EXTMEM
+EXTMEM static uint8_t bbBuf[BLACKBOX_RAM_BYTES];
+#else
+DMAMEM static uint8_t bbBuf[BLACKBOX_RAM_BYTES];
+#endif
+static SlotRing bbRing = { bbBuf, BLACKBOX_RAM_BYTES };
+static bool     capturing      = false;
+static uint32_t captureEndMs   = 0;
+static bool     triggerForced  = false;   // 'x' command
+static const char* triggerWaiting = nullptr;   // fired while the last capture was still closing
+static uint32_t capturesTaken  = 0;
+static_assert(TRIGGER_COUNT <= MAX_CONDS, "too many TRIGGERS");
+static CondSet  triggers = { TRIGGERS, TRIGGER_COUNT };
+
+static void blackboxArm() {
+    bbRing.format(sizeof(SampleHdr) + ochBlockSize);
+    capturing = false;
+    triggerForced = false;
+    triggerWaiting = nullptr;
+
+    Serial.print("[BBX] Armed: "); Serial.print(bbRing.slots); Serial.print(" samples buffered, ");
+    Serial.print(PRETRIGGER_MS); Serial.print(" ms pre / "); Serial.print(POSTTRIGGER_MS);
+    Serial.println(" ms post-trigger");
+    if (bbRing.slots * pollIntervalMs < PRETRIGGER_MS)
+        Serial.println("[BBX] Ring holds less than PRETRIGGER_MS at the normal poll rate");
+    condBegin(triggers, "[BBX]");
+}
+
+// What fired on this blob — a TRIGGERS channel, the pin or 'x' — or nullptr.
+static const char* checkTriggers(const uint8_t* blob) {
+    const char* fired = condEval(triggers, blob);
+    if (!fired && hal.trigger && hal.trigger()) fired = "input pin";
+    if (!fired && triggerForced)                fired = "command";
+    triggerForced = false;
+    return fired;
+}
+
+// Buffer one sample; open a capture if it trips a trigger. false if
+// the capture's log could not be opened. A trigger that fires while the
+// previous capture is still closing waits for the drain task to finish
+// it; the ring stops dropping old samples meanwhile.
+static bool blackboxSample(const SampleHdr& h) {
+    if (!capturing && !triggerWaiting) {
+        // Keep only the pre-trigger window, oldest first out.
+        while (!bbRing.empty()) {
+            const SampleHdr* old = (const SampleHdr*)bbRing.front();
+            if (h.ms - old->ms <= PRETRIGGER_MS && !bbRing.full()) break;
+            bbRing.pop();
+        }
+    }
+    uint8_t* slot = bbRing.push();
+    if (slot) {
+        memcpy(slot, &h, sizeof(h));
+        memcpy(slot + sizeof(h), ochBuffer, ochBlockSize);
+    } else {
+        rowsDropped++;   // capture outrunning the card
+    }
+
+    const char* why = checkTriggers(ochBuffer);
+    if (why) {
+        captureEndMs = h.ms + POSTTRIGGER_MS;
+        if (!capturing && !triggerWaiting) triggerWaiting = why;
+    }
+    if (capturing || !triggerWaiting || closing != CloseStep::None) return true;
+
+    why = triggerWaiting;
+    triggerWaiting = nullptr;
+    if (hostWriting("[BBX]")) return true;   // trigger lost; the pre-trigger window keeps rolling
+    const SampleHdr* oldest = (const SampleHdr*)bbRing.front();
+    if (!openLog(oldest ? oldest->ms : h.ms)) return false;
+    capturing = true;
+    capturesTaken++;
+    setLED(&PAT_LOG);
+    Serial.print("[BBX] Trigger: "); Serial.print(why); Serial.print(" — ");
+    Serial.print(bbRing.used()); Serial.println(" buffered samples");
+    return true;
+}
+
+// Move buffered samples into the log while the staging ring has room;
+// hand the capture to the drain task to close once the post-trigger
+// window has passed and the ring is empty.
+static void blackboxStep() {
+    if (!capturing) return;
+    for (uint8_t n = 0; n < BLACKBOX_REPLAY_ROWS && !bbRing.empty(); n++) {
+        if (sdRing.space() < ROW_BUF_SIZE) break;
+        const uint8_t* slot = bbRing.front();
+        writeRow(*(const SampleHdr*)slot, slot + sizeof(SampleHdr));
+        bbRing.pop();
+    }
+    if (bbRing.empty() && (int32_t)(halMillis() - captureEndMs) >= 0) {
+        beginClose();
+        capturing = false;
+        triggers.prevValid = false;
+        setLED(&PAT_ARMED);
+        Serial.print("[BBX] Capture "); Serial.print(capturesTaken); Serial.println(" done, re-armed.");
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Automatic sessions
+// ─────────────────────────────────────────────────────────────
+// A log opens on the first sample where any START_WHEN condition holds
+// and closes once all STOP_WHEN conditions have held for STOP_HOLD_MS,
+// so each drive gets its own file. Between sessions the ECU is polled
+// every IDLE_POLL_MS and nothing is written.
+bool autoSession = AUTO_SESSION;
+
+static_assert(START_WHEN_COUNT <= MAX_CONDS && STOP_WHEN_COUNT <= MAX_CONDS, "too many conditions");
+static CondSet  startConds = { START_WHEN, START_WHEN_COUNT };
+static CondSet  stopConds  = { STOP_WHEN,  STOP_WHEN_COUNT };
+static bool     stopHolding   = false;
+static uint32_t stopSinceMs   = 0;
+static uint32_t sessionsTaken = 0;
+
+static void autoArm() {
+    condBegin(startConds, "[AUTO]");
+    condBegin(stopConds,  "[AUTO]");
+    stopHolding = false;
+    if (!startConds.resolved) Serial.println("[AUTO] No START_WHEN channel in this INI — no session will start");
+    Serial.print("[AUTO] Waiting for a start condition, polling every ");
+    Serial.print(IDLE_POLL_MS); Serial.println(" ms");
+}
+
+// Open, log into, or close the current session. false if a session's
+// log could not be opened.
+static bool autoSample(const SampleHdr& h) {
+    if (!logOpen) {
+        const char* why = condEval(startConds, ochBuffer);
+        // A session that just ended is still closing: start on a later sample.
+        if (!why || closing != CloseStep::None || hostWriting("[AUTO]")) return true;
+        if (!openLog(h.ms)) return false;
+        sessionsTaken++;
+        stopHolding = false;
+        stopConds.prevValid = false;
+        setLED(&PAT_LOG);
+        Serial.print("[AUTO] Session "); Serial.print(sessionsTaken);
+        Serial.print(" started: "); Serial.println(why);
+    }
+    writeRow(h, ochBuffer);
+
+    condEval(stopConds, ochBuffer);
+    if (!condAllHeld(stopConds)) { stopHolding = false; return true; }
+    if (!stopHolding) { stopHolding = true; stopSinceMs = h.ms; return true; }
+    if (h.ms - stopSinceMs < STOP_HOLD_MS) return true;
+
+    uint32_t durMs = h.ms - logStartMs;
+    beginClose();
+    startConds.prevValid = false;
+    setLED(&PAT_ARMED);
+    Serial.print("[AUTO] Session "); Serial.print(sessionsTaken); Serial.print(" closed after ");
+    Serial.print(durMs / 1000); Serial.println(" s, waiting.");
+    return true;
+}
+
+// Between auto sessions: full block only, at IDLE_POLL_MS.
+static bool pollingIdle() { return autoSession && !blackboxMode && !logOpen; }
+
+// Period of the full-block poll; rate groups keep their own.
+static uint32_t pollPeriodMs() {
+    if (capturing)     return TRIGGER_POLL_MS;
+    if (pollingIdle()) return IDLE_POLL_MS;
+    return ratesFullPeriodMs(pollIntervalMs);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  RusEFI communication
+// ─────────────────────────────────────────────────────────────
+static void flushSerial() { while (hal.ecu->available()) hal.ecu->read(); }
+
+// Text replies ('S', 'F') are collected across loop() passes. A reply ends
+// at '\0' / '\n', or 500 ms after the last printable byte.
+static size_t   rspLen    = 0;
+static uint32_t rspLastMs = 0;
+
+static void beginResponse() { rspLen = 0; rspLastMs = halMillis(); }
+
+static Step readResponseStep(char* dst, size_t maxLen) {
+    while (hal.ecu->available()) {
+        uint8_t c = hal.ecu->read();
+        if (c == '\0' || c == '\n') {
+            dst[rspLen] = '\0';
+            return rspLen > 0 ? Step::Done : Step::Failed;
+        }
+        if (c >= 0x20 && rspLen < maxLen - 1) {
+            dst[rspLen++] = c;
+            rspLastMs = halMillis();
+        }
+    }
+    dst[rspLen] = '\0';
+    if (rspLen > 0 && halMillis() - rspLastMs >= 500) return Step::Done;
+    return Step::Pending;
+}
+
+// 'O' request and response are split so loop() keeps running while the
+// ECU answers: sendOCHRequest() writes the frame, readOCHStep() collects
+// whatever has arrived and reports Done / Failed once the frame completes
+// or the deadline passes (1500 ms to first byte, 200 ms between bytes).
+// A range longer than ochCommand.chunk goes out as several requests, up
+// to OCH_PIPELINE of them in flight; replies arrive in order and each is
+// checked and copied before the next is read. If one fails while later
+// requests are still out, their replies are discarded: nothing is sent
+// until the line has been quiet for OCH_RESYNC_MS.
+static uint8_t  ochRx[OCH_BUF_SIZE + 8];
+static OchRange ochReq       = {};   // offset / count of the outstanding range
+static uint16_t ochSent      = 0;    // bytes of ochReq requested so far
+static uint16_t ochGot       = 0;    // bytes of ochReq received and checked
+static uint16_t ochRxLen     = 0;
+static uint32_t ochDeadline  = 0;
+static bool     ochResync    = false;  // discarding replies to a failed pipelined read
+static uint32_t ochQuietMs   = 0;      // halMillis() of the last byte discarded
+#ifndef DISABLE_PROFILING
+static uint32_t ochSentTicks = 0;
+#endif
+
+// False until the replies to a failed read have stopped arriving.
+static bool ochLineQuiet() {
+    if (!ochResync) return true;
+    if (hal.ecu->available()) { flushSerial(); ochQuietMs = halMillis(); return false; }
+    if (halMillis() - ochQuietMs < OCH_RESYNC_MS) return false;
+    ochResync = false;
+    return true;
+}
+
+static void sendChunks() {
+    uint32_t window = (uint32_t)ochCommand.chunk * OCH_PIPELINE;
+    while (ochSent < ochReq.count && (uint32_t)(ochSent - ochGot) < window) {
+        uint16_t n = min((uint16_t)(ochReq.count - ochSent), ochCommand.chunk);
+        uint8_t frame[OCH_CMD_MAX + 6];
+        uint8_t len = ochRequest(ochReq.offset + ochSent, n, frame + 2);
+        uint32_t checksum = crc32(frame + 2, len);
+        frame[0] = 0;
+        frame[1] = len;
+        frame[2 + len]     = (uint8_t)(checksum >> 24);
+        frame[2 + len + 1] = (uint8_t)(checksum >> 16);
+        frame[2 + len + 2] = (uint8_t)(checksum >> 8);
+        frame[2 + len + 3] = (uint8_t)(checksum);
+        hal.ecu->write(frame, len + 6);
+        ochSent += n;
+    }
+}
+
+static void sendOCHRequest(const OchRange& r) {
+    PROF_BEGIN(tSend);
+    ochReq = ochCommand.ranged() ? r : OchRange{ 0, ochBlockSize };
+    ochSent = 0;
+    ochGot  = 0;
+    flushSerial();
+    sendChunks();
+    PROF_END(PS_SEND, tSend);
+    PROF_STAMP(ochSentTicks);
+    ochSentUs = halMicros();
+
+    ochRxLen    = 0;
+    ochDeadline = halMillis() + 1500;
+    ochPending  = true;
+}
+
+static Step readOCHStep() {
+    const uint16_t count  = min((uint16_t)(ochReq.count - ochGot), ochCommand.chunk);
+    const uint16_t toRead = count + 7;
+    bool got = false;
+#ifndef DISABLE_PROFILING
+    if (ochGot == 0 && ochRxLen == 0 && hal.ecu->available()) PROF_END(PS_FIRST_BYTE, ochSentTicks);
+#endif
+    if (ochRxLen < toRead) {
+        size_t n = hal.ecu->read(ochRx + ochRxLen, toRead - ochRxLen);
+        ochRxLen += n;
+        got = n > 0;
+    }
+    if (got) ochDeadline = halMillis() + 200;
+    if (ochRxLen < toRead && (int32_t)(halMillis() - ochDeadline) < 0) return Step::Pending;
+    ochPending = false;
+    if ((uint16_t)(ochSent - ochGot) > count) {   // cleared again if this chunk checks out
+        ochResync  = true;
+        ochQuietMs = halMillis();
+    }
+
+    if (ochRxLen == 0) { Serial.println("[ECU] No response"); pollFails++; return Step::Failed; }
+
+    // [len:2][status:1][payload][crc32:4] — CRC covers status + payload
+    if (ochRxLen == toRead && ochRx[2] == 0x00) {
+        const uint8_t* c = ochRx + 3 + count;
+        uint32_t rxCrc = ((uint32_t)c[0] << 24) | ((uint32_t)c[1] << 16) | ((uint32_t)c[2] << 8) | c[3];
+        if (crc32(ochRx + 2, count + 1) != rxCrc) {
+            crcErrors++; pollFails++;
+            Serial.println("[ECU] CRC mismatch — sample dropped");
+            return Step::Failed;
+        }
+        memcpy(ochBuffer + ochReq.offset + ochGot, ochRx + 3, count);   // rest keeps last-known values
+        ochResync = false;
+        ochGot += count;
+        if (ochGot < ochReq.count) {
+            sendChunks();
+            ochRxLen    = 0;
+            ochDeadline = halMillis() + 1500;
+            ochPending  = true;
+            return Step::Pending;
+        }
+        PROF_END(PS_LAST_BYTE, ochSentTicks);
+        ecuRttUs     = halMicros() - ochSentUs;
+        sampleDtUs   = lastSampleUs ? ochSentUs - lastSampleUs : 0;
+        lastSampleUs = ochSentUs;
+        return Step::Done;
+    }
+    pollFails++;
+
+    Serial.print("[ECU] Bad rx="); Serial.print(ochRxLen);
+    Serial.print(" first16: ");
+    for (int i = 0; i < min((int)ochRxLen, 16); i++) {
+        if (ochRx[i] < 0x10) Serial.print('0');
+        Serial.print(ochRx[i], HEX); Serial.print(' ');
+    }
+    Serial.println();
+    return Step::Failed;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  State helpers
+// ─────────────────────────────────────────────────────────────
+static void enterState(State s) { state = s; stateEnterMs = halMillis(); }
+
+static void onDisconnect() {
+    Serial.println("[USB] ECU disconnected.");
+    if (logOpen || closing != CloseStep::None) {
+        closeLog();
+        Serial.println("[SD]  Log closed.");
+    }
+    abortINI();
+    ochPending = false;
+    ochResync  = false;
+    telemEnd();
+    numChannels = 0; numDLChannels = 0; ochBlockSize = 0; signature[0] = '\0';
+    setLED(&PAT_WAIT);
+    enterState(State::WaitDevice);
+}
+
+const char* stateName(State s) {
+    switch (s) {
+        case State::WaitDevice:     return "WaitDevice";
+        case State::AssertDTR:      return "AssertDTR";
+        case State::SettleDTR:      return "SettleDTR";
+        case State::GetSignature:   return "GetSignature";
+        case State::RetrySignature: return "RetrySignature";
+        case State::LoadINI:        return "LoadINI";
+        case State::ParseINI:       return "ParseINI";
+        case State::ModeSwitch:     return "ModeSwitch";
+        case State::SettleMode:     return "SettleMode";
+        case State::Logging:        return "Logging";
+        case State::Stopped:        return "Stopped";
+        case State::ErrorSD:        return "ErrorSD";
+        case State::ErrorINI:       return "ErrorINI";
+    }
+    return "?";
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Serial commands
+// ─────────────────────────────────────────────────────────────
+void loggerCommand(char cmd) {
+    if (cmd == 't' || cmd == 'T') {
+        // Set RTC to compile time — use after VBAT replacement
+        uint32_t ct = compileTime();
+        hal.rtc->set(ct);
+        rtcOK = true;
+        DateTime t;
+        toDateTime(ct, t);
+        char tbuf[32];
+        snprintf(tbuf, sizeof(tbuf), "%04d-%02d-%02d %02d:%02d:%02d",
+            t.year, t.month, t.day, t.hour, t.minute, t.second);
+        Serial.print("[RTC] Set to compile time: "); Serial.println(tbuf);
+    }
+
+    if (cmd == 's' || cmd == 'S') {
+        if (state == State::Logging) {
+            closeLog();
+            Serial.println("[CMD] Logging stopped. Power-cycle to resume.");
+        }
+        abortINI();
+        ochPending = false;
+        setLED(&PAT_MTP);
+        enterState(State::Stopped);
+    }
+
+    if (cmd == 'b' || cmd == 'B') {
+        if (state == State::Logging)       Serial.println("[BENCH] Stop logging first ('s').");
+        else if (state == State::ErrorSD)  Serial.println("[BENCH] No SD card.");
+        else switch (sdBenchStart()) {
+            case BenchStart::Busy:   Serial.println("[BENCH] Already running."); break;
+            case BenchStart::NoFile: Serial.println("[BENCH] Cannot create scratch file."); break;
+            case BenchStart::Started: break;
+        }
+    }
+
+    if (cmd == 'x' || cmd == 'X') {
+        if (blackboxMode && state == State::Logging) triggerForced = true;
+        else Serial.println("[BBX] Not armed (black-box mode off or not connected).");
+    }
+
+    if (cmd == 'l' || cmd == 'L') telemStart(true);
+    if (cmd == 'q' || cmd == 'Q') telemStart(false);
+    if (cmd == 'u' || cmd == 'U') schedPrintUsage();
+    if (cmd == 'p' || cmd == 'P') profPrintAndReset();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  State machine — one non-blocking step per loop() pass
+// ─────────────────────────────────────────────────────────────
+void loggerStep() {
+    if (state == State::ErrorSD) return;
+    if (sdBenchActive()) return;   // the card belongs to 'b' until it finishes
+
+    if (!hal.ecu->connected() && state != State::WaitDevice && state != State::Stopped) {
+        onDisconnect();
+        return;
+    }
+
+    switch (state) {
+
+    case State::WaitDevice:
+        if (hal.ecu->connected()) {
+            Serial.println("[USB] ECU detected.");
+            setLED(&PAT_CONNECT);
+            enterState(State::AssertDTR);
+        }
+        break;
+
+    case State::AssertDTR:
+        if (halMillis() - stateEnterMs >= 300) {
+            Serial.println("[USB] Asserting DTR + RTS...");
+            hal.ecu->setDTR(true);
+            hal.ecu->setRTS(true);
+            enterState(State::SettleDTR);
+        }
+        break;
+
+    case State::SettleDTR:
+        if (halMillis() - stateEnterMs >= 200) {
+            flushSerial();
+            Serial.println("[TS]  Requesting signature...");
+            hal.ecu->write('S');
+            beginResponse();
+            enterState(State::GetSignature);
+        }
+        break;
+
+    case State::GetSignature:
+        switch (readResponseStep(signature, sizeof(signature))) {
+        case Step::Done:
+            Serial.print("[ECU] Signature: "); Serial.println(signature);
+            sigToFilename(signature, iniFilename, sizeof(iniFilename));
+            Serial.print("[INI] Looking for: "); Serial.print(iniFilename);
+            Serial.println(" (fallback: DEFAULT.INI)");
+            enterState(State::LoadINI);
+            break;
+        case Step::Failed:
+            Serial.println("[ECU] Empty response — retrying...");
+            enterState(State::RetrySignature);
+            break;
+        case Step::Pending:
+            if (rspLen == 0 && halMillis() - stateEnterMs > 4000) {
+                Serial.println("[ECU] Signature timeout — retrying...");
+                flushSerial();
+                hal.ecu->write('S');
+                beginResponse();
+                stateEnterMs = halMillis();
+            }
+            break;
+        }
+        break;
+
+    case State::RetrySignature:
+        if (halMillis() - stateEnterMs >= 1000) {
+            flushSerial();
+            hal.ecu->write('S');
+            beginResponse();
+            enterState(State::GetSignature);
+        }
+        break;
+
+    case State::LoadINI: {
+        bool ok = false;
+        if (hal.fs->exists(iniFilename))       { ok = beginINI(iniFilename); }
+        else if (hal.fs->exists("DEFAULT.INI")) { Serial.println("[INI] Using DEFAULT.INI"); ok = beginINI("DEFAULT.INI"); }
+        else {
+            Serial.println("[INI] No INI found on SD card!");
+            Serial.print  ("[INI] Expected: "); Serial.println(iniFilename);
+            Serial.println("[INI] Or rename your INI to DEFAULT.INI");
+        }
+
+        if (ok) {
+            enterState(State::ParseINI);
+        } else {
+            setLED(&PAT_ERROR);
+            enterState(State::ErrorINI);
+        }
+        break;
+    }
+
+    case State::ParseINI:
+        switch (stepINI()) {
+        case Step::Pending:
+            break;
+        case Step::Done:
+            telemBegin(signature);
+            tablesLoad();
+            Serial.println("[TS]  Sending 'F' (CRC binary mode)...");
+            flushSerial();
+            hal.ecu->write('F');
+            beginResponse();
+            enterState(State::ModeSwitch);
+            break;
+        case Step::Failed:
+            setLED(&PAT_ERROR);
+            enterState(State::ErrorINI);
+            break;
+        }
+        break;
+
+    case State::ModeSwitch:
+        // Any reply (or none within 1 s) is accepted — 'F' only needs to land.
+        if (readResponseStep(fResponse, sizeof(fResponse)) != Step::Pending
+            || (rspLen == 0 && halMillis() - stateEnterMs >= 1000)) {
+            Serial.print("[TS]  F response: \""); Serial.print(fResponse); Serial.println("\"");
+            flushSerial();
+            enterState(State::SettleMode);
+        }
+        break;
+
+    case State::SettleMode:
+        if (halMillis() - stateEnterMs < 50) break;
+        if (!blackboxMode && !autoSession && hostWriting("[LOG]")) break;   // wait for the upload
+        pollFails = crcErrors = 0;
+        lastSampleUs = sampleDtUs = ecuRttUs = sdLatencyUs = 0;
+        ratesBegin();
+        if (blackboxMode) {
+            blackboxArm();
+            setLED(&PAT_ARMED);
+            enterState(State::Logging);
+        } else if (autoSession) {
+            autoArm();
+            setLED(&PAT_ARMED);
+            enterState(State::Logging);
+        } else if (openLog(halMillis())) {
+            setLED(&PAT_LOG);
+            enterState(State::Logging);
+            Serial.print("[LOG] Logging ");
+            Serial.print(numDLChannels > 0 ? numDLChannels : numChannels);
+            Serial.println(" channels. Go!");
+        } else {
+            setLED(&PAT_ERROR);
+            enterState(State::ErrorINI);
+        }
+        break;
+
+    case State::Logging:
+        if (ochPending) {
+            Step st = readOCHStep();
+            if (st != Step::Pending && ratesDone(st == Step::Done)) {
+                SampleHdr h = { halMillis(), sampleDtUs, ecuRttUs };
+                telemSample(h.ms, ochBuffer);
+                bool ok = true;
+                if (blackboxMode)     ok = blackboxSample(h);
+                else if (autoSession) ok = autoSample(h);
+                else                  writeRow(h, ochBuffer);
+                if (!ok) {
+                    setLED(&PAT_ERROR);
+                    enterState(State::ErrorINI);
+                    break;
+                }
+            }
+        } else {
+            OchRange r;
+            if (ochLineQuiet() && ratesNext(halMillis(), pollPeriodMs(), !pollingIdle(), r)) sendOCHRequest(r);
+        }
+        if (blackboxMode) blackboxStep();
+        break;
+
+    case State::Stopped:
+        break;
+
+    case State::ErrorINI:
+        if (halMillis() - stateEnterMs > 10000) {
+            stateEnterMs = halMillis();
+            Serial.println("[ERR] No INI — power-cycle after inserting SD.");
+            Serial.print  ("[ERR] Expected: "); Serial.println(iniFilename);
+            Serial.println("[ERR] Or: DEFAULT.INI");
+        }
+        break;
+
+    default: break;
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Scheduler hooks
+// ─────────────────────────────────────────────────────────────
+void loggerDrainTask() {
+    if (closing != CloseStep::None) { closeStep(); return; }
+    if (!logOpen) return;
+    // At most one card operation per pass: a sync after the drain that
+    // reached the boundary, never both in the same pass.
+    if (syncClusters && logBytes % clusterBytes == 0
+        && logBytes / clusterBytes >= syncedBytes / clusterBytes + syncClusters) {
+        syncLog(true);
+        return;
+    }
+    bool ageDue = unsynced && (uint32_t)(halMillis() - unsyncedSinceMs) >= syncIntervalMs;
+    if (sdRing.used() >= SD_CHUNK || (ageDue && sdRing.used() > 0)) { drainRing(); return; }
+    if (ageDue) syncLog(false);
+}
+
+// Time until the next 'O' request is due. While a reply is outstanding
+// or the line is resyncing there is nothing to protect — the next poll
+// cannot go out anyway.
+uint32_t loggerSlackUs() {
+    if (state != State::Logging || ochPending || ochResync) return UINT32_MAX;
+    uint32_t ms = ratesSlackMs(halMillis(), pollPeriodMs(), !pollingIdle());
+    return ms >= UINT32_MAX / 1000 ? UINT32_MAX : ms * 1000;
+}
+
+State       loggerState()      { return state; }
+const char* loggerActiveLog()  { return logOpen || closing != CloseStep::None ? logPath : nullptr; }
+uint32_t    loggerLogsClosed() { return logsClosed; }
+
+void loggerPrintBufferStats() {
+    Serial.print("[CPU] SD ring "); Serial.print(sdRing.used()); Serial.print('/');
+    Serial.print(SD_RING_SIZE); Serial.print(" bytes, rows dropped ");
+    Serial.print(rowsDropped); Serial.print(", write errors ");
+    Serial.println(writeErrors);
+    if (logOpen) printSyncStats();
+    telemPrintStats();
+}
+
+void loggerBegin(bool sdOK) {
+    if (sdOK) { setLED(&PAT_WAIT);  enterState(State::WaitDevice); }
+    else      { setLED(&PAT_ERROR); enterState(State::ErrorSD); }
+}
@@ -0,0 +1,51 @@
+// ============================================================
+//  logger.h — ECU handshake, polling and MSL logging
+// ============================================================
+//
+//  The portable core of the logger: the connection state machine,
+//  'O' polling, blob decoding, row formatting and the SD staging ring.
+//  Everything goes through hal.h, so the same code runs on the Teensy
+//  and in the host build.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+#include "ini.h"
+
+enum class State : uint8_t {
+    WaitDevice,
+    AssertDTR,       // 300 ms after enumeration → raise DTR/RTS
+    SettleDTR,       // 200 ms for the ECU to notice DTR → send 'S'
+    GetSignature,
+    RetrySignature,  // 1 s back-off after an empty signature reply
+    LoadINI,         // open INI file
+    ParseINI,        // INI_LINES_PER_PASS lines per pass
+    ModeSwitch,      // 'F' sent, collecting reply (1 s max)
+    SettleMode,      // 50 ms quiet time before first 'O'
+    Logging,
+    Stopped,   // 's' command — card writable over MTP, power-cycle to resume
+    ErrorSD, ErrorINI,
+};
+
+extern bool     rtcOK;            // true when the RTC holds a valid time (year >= 2024)
+extern uint32_t pollIntervalMs;   // 'O' period; POLL_INTERVAL_MS unless overridden
+extern uint32_t syncIntervalMs;   // max age of unsynced rows; SYNC_INTERVAL_MS unless set by 'b'
+extern uint32_t syncClusters;     // sync every N clusters written (0 = age only); SYNC_CLUSTERS
+extern bool     blackboxMode;     // log only around triggers; BLACKBOX_MODE unless overridden
+extern bool     sparseLog;        // change-of-value .tsb rows instead of .msl text; SPARSE_LOG
+extern bool     autoSession;      // open/close logs on channel conditions; AUTO_SESSION unless overridden
+
+void        loggerBegin(bool sdOK);
+void        loggerStep();          // "ecu" task — one state-machine step
+void        loggerDrainTask();     // "sd" task — staging ring → card, periodic flush
+void        loggerLedTask();       // "led" task
+void        loggerCommand(char cmd);
+
+State       loggerState();
+const char* stateName(State s);
+uint32_t    loggerSlackUs();       // time until the next 'O' is due
+const char* loggerActiveLog();     // path of the log being written, nullptr if none
+uint32_t    loggerLogsClosed();    // logs closed since boot (new files for MTP)
+void        loggerHostWrite(bool open);   // MTP opened / closed a file for writing; no log opens meanwhile
+void        loggerPrintBufferStats();
+uint32_t    compileTime();
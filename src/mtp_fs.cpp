@@ -0,0 +1,166 @@
+// ============================================================
+//  mtp_fs.cpp — MTP access to the card alongside logging
+// ============================================================
+#ifndef DISABLE_MTP
+#include "mtp_fs.h"
+#include <new>
+#include <strings.h>
+#include "config.h"
+#include "hal.h"
+#include "logger.h"
+#include "scheduler.h"
+
+static constexpr const char* MTP_INDEX_FILE = "mtpindex.dat";   // MTP_Teensy's object index
+
+static uint32_t lastIoMs = 0;
+
+uint32_t mtpLastIoMs() { return lastIoMs; }
+
+// ─────────────────────────────────────────────────────────────
+//  Arbitration
+// ─────────────────────────────────────────────────────────────
+// MTP paths start with '/', the logger's do not; FAT names ignore case.
+static bool samePath(const char* mtpPath, const char* path) {
+    while (*mtpPath == '/') mtpPath++;
+    return strcasecmp(mtpPath, path) == 0;
+}
+
+static bool isActiveLog(const char* path) {
+    const char* log = loggerActiveLog();
+    return log && samePath(path, log);
+}
+
+// Armed black-box and idle auto sessions count: a log may open on any sample.
+static bool locked(const char* op) {
+    if (loggerState() != State::Logging) return false;
+    Serial.print("[MTP] Read-only while logging — "); Serial.print(op); Serial.println(" refused.");
+    return true;
+}
+
+// Run the other tasks until the next poll is far enough away for one
+// card access. Always yields once, so a long transfer outside a log
+// session still keeps USB host, serial and the LED going.
+static void waitForSlack() {
+    while (schedYield() && loggerSlackUs() < MTP_IO_BUDGET_US) {}
+    lastIoMs = halMillis();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Files and folders
+// ─────────────────────────────────────────────────────────────
+class MtpFile : public FileImpl {
+public:
+    MtpFile(const File& f, const char* p, bool w) : inner(f), writer(w) {
+        strncpy(path, p, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        if (writer) loggerHostWrite(true);
+    }
+    ~MtpFile() { endWrite(); }
+    static void operator delete(void* p);   // back to the pool
+
+private:
+    File inner;
+    char path[64];   // folder entries are matched against the active log
+    bool writer;     // counted in loggerHostWrite() until closed
+
+    void endWrite() {
+        if (writer) loggerHostWrite(false);
+        writer = false;
+    }
+
+    size_t read(void* buf, size_t n) override         { waitForSlack(); return inner.read(buf, n); }
+    size_t write(const void* buf, size_t n) override  { waitForSlack(); return inner.write(buf, n); }
+    int      available() override                     { return inner.available(); }
+    int      peek() override                          { return inner.peek(); }
+    void     flush() override                         { inner.flush(); }
+    bool     truncate(uint64_t size) override         { return inner.truncate(size); }
+    bool     seek(uint64_t pos, int mode) override    { return inner.seek(pos, mode); }
+    uint64_t position() override                      { return inner.position(); }
+    uint64_t size() override                          { return inner.size(); }
+    void     close() override                         { inner.close(); endWrite(); }
+    bool     isOpen() override                        { return (bool)inner; }
+    const char* name() override                       { return inner.name(); }
+    bool     isDirectory() override                   { return inner.isDirectory(); }
+    void     rewindDirectory() override               { inner.rewindDirectory(); }
+    bool getCreateTime(DateTimeFields& tm) override       { return inner.getCreateTime(tm); }
+    bool getModifyTime(DateTimeFields& tm) override       { return inner.getModifyTime(tm); }
+    bool setCreateTime(const DateTimeFields& tm) override { return inner.setCreateTime(tm); }
+    bool setModifyTime(const DateTimeFields& tm) override { return inner.setModifyTime(tm); }
+
+    // Entries are only listed (name, size, times), so they go out unwrapped.
+    File openNextFile(uint8_t mode) override {
+        for (;;) {
+            File f = inner.openNextFile(mode);
+            if (!f || !isActiveEntry(f.name())) return f;
+        }
+    }
+
+    bool isActiveEntry(const char* entry) const {
+        const char* log = loggerActiveLog();
+        if (!log) return false;
+        const char* dir = path;
+        while (*dir == '/') dir++;
+        size_t n = strlen(dir);
+        while (n && dir[n - 1] == '/') n--;
+        if (n && (strncasecmp(log, dir, n) != 0 || log[n] != '/')) return false;
+        return strcasecmp(log + (n ? n + 1 : 0), entry) == 0;
+    }
+};
+
+alignas(MtpFile) static uint8_t pool[MTP_OPEN_FILES][sizeof(MtpFile)];
+static bool poolUsed[MTP_OPEN_FILES] = {};
+
+void MtpFile::operator delete(void* p) {
+    poolUsed[((uint8_t*)p - pool[0]) / sizeof(MtpFile)] = false;
+}
+
+static File wrap(const File& f, const char* path, bool writer) {
+    for (uint8_t i = 0; i < MTP_OPEN_FILES; i++) {
+        if (poolUsed[i]) continue;
+        poolUsed[i] = true;
+        return File(::new (pool[i]) MtpFile(f, path, writer));
+    }
+    Serial.println("[MTP] Too many open files.");
+    return File();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Filesystem
+// ─────────────────────────────────────────────────────────────
+class MtpCard : public FS {
+public:
+    FS* card = nullptr;
+
+    File open(const char* path, uint8_t mode) override {
+        if (isActiveLog(path)) return File();
+        bool writer = mode != FILE_READ && !samePath(path, MTP_INDEX_FILE);
+        if (writer && locked("write")) return File();
+        File f = card->open(path, mode);
+        return f ? wrap(f, path, writer) : f;
+    }
+    bool exists(const char* path) override { return !isActiveLog(path) && card->exists(path); }
+    bool mkdir(const char* path) override  { return !locked("new folder") && card->mkdir(path); }
+    bool rename(const char* from, const char* to) override { return !locked("rename") && card->rename(from, to); }
+    bool remove(const char* path) override { return !locked("delete") && card->remove(path); }
+    bool rmdir(const char* path) override  { return !locked("delete") && card->rmdir(path); }
+    uint64_t usedSize() override {
+        if (!loggerActiveLog() || !usedBytes) usedBytes = card->usedSize();
+        return usedBytes;
+    }
+    uint64_t totalSize() override { return card->totalSize(); }
+    bool format(int type, char progressChar, Print& pr) override {
+        return !locked("format") && card->format(type, progressChar, pr);
+    }
+    bool mediaPresent() override { return card->mediaPresent(); }
+
+private:
+    uint64_t usedBytes = 0;
+};
+
+static MtpCard mtpCard;
+
+FS& mtpStorage(FS& card) {
+    mtpCard.card = &card;
+    return mtpCard;
+}
+#endif
@@ -0,0 +1,30 @@
+// ============================================================
+//  mtp_fs.h — the SD card as MTP sees it while a log is written
+// ============================================================
+//
+//  MTP registers this FS instead of SD and passes reads through.
+//    - the active log is left out of folder listings and cannot be
+//      opened; it shows up once closed (main.cpp then sends a device
+//      reset so the host re-reads the card)
+//    - while the logger is in State::Logging — also when a black-box
+//      is armed or an automatic session is idle — the card is
+//      read-only to the host: uploads, deletes, renames, new folders
+//      and format are refused. MTP's own object index is the one file
+//      it may still write
+//    - a file the host opened for writing before that is counted in
+//      loggerHostWrite() until closed; no log opens meanwhile
+//    - every file read or write first waits until the next ECU poll is
+//      at least MTP_IO_BUDGET_US away, running the other tasks through
+//      schedYield() meanwhile. MTP_Teensy sends a whole file inside one
+//      MTP.loop() call, so this is where a transfer gives way to polls
+//      and to the SD drain
+//    - while a log is open, usedSize() (a FAT scan on large cards)
+//      returns the last value
+//  Open files and folders come from a pool of MTP_OPEN_FILES.
+// ============================================================
+#pragma once
+
+#include <FS.h>
+
+FS&      mtpStorage(FS& card);   // the FS to hand to MTP.addFilesystem()
+uint32_t mtpLastIoMs();          // halMillis() of the last file read or write
@@ -0,0 +1,70 @@
+// ============================================================
+//  native/arduino_compat.cpp
+// ============================================================
+#include "arduino_compat.h"
+#include <poll.h>
+#include <unistd.h>
+
+Console Serial;
+
+static bool stdinEOF = false;
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* buf) {
+    sprintf(buf, "%*.*f", width, prec, val);
+    return buf;
+}
+
+size_t Print::write(const uint8_t* buf, size_t n) {
+    size_t r = 0;
+    while (n--) r += write(*buf++);
+    return r;
+}
+
+size_t Print::print(double v, int digits) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf);
+}
+
+size_t Print::printUnsigned(unsigned long long n, int base) {
+    if (base < 2) base = 10;
+    char buf[66];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do {
+        int d = (int)(n % base);
+        *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+        n /= base;
+    } while (n);
+    return write(p);
+}
+
+size_t Print::printSigned(long long n, int base) {
+    // Arduino prints negative numbers in non-decimal bases as two's complement
+    if (base != DEC) return printUnsigned((unsigned long)n, base);
+    if (n < 0) return write((uint8_t)'-') + printUnsigned(0ULL - (unsigned long long)n, base);
+    return printUnsigned((unsigned long long)n, base);
+}
+
+int Console::available() {
+    if (stdinEOF) return 0;
+    struct pollfd p = { STDIN_FILENO, POLLIN, 0 };
+    return (poll(&p, 1, 0) > 0 && (p.revents & (POLLIN | POLLHUP))) ? 1 : 0;
+}
+
+int Console::read() {
+    if (!available()) return -1;
+    unsigned char c;
+    if (::read(STDIN_FILENO, &c, 1) == 1) return c;
+    stdinEOF = true;
+    return -1;
+}
+
+size_t Console::write(uint8_t c) { return muted ? 1 : fwrite(&c, 1, 1, stdout); }
+
+size_t Console::write(const uint8_t* buf, size_t n) {
+    if (muted) return n;
+    size_t r = fwrite(buf, 1, n, stdout);
+    if (memchr(buf, '\n', n)) fflush(stdout);
+    return r;
+}
@@ -0,0 +1,75 @@
+// ============================================================
+//  native/arduino_compat.h — the slice of the Arduino core the
+//  logger uses, for the host build
+// ============================================================
+//
+//  Print (print/println of strings, integers in any base and floats),
+//  a Serial console on stdin/stdout, dtostrf() and Arduino-style
+//  min()/max(). Memory-placement attributes expand to nothing.
+// ============================================================
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+
+#define DMAMEM
+#define EXTMEM
+#define FASTRUN
+
+#define DEC 10
+#define HEX 16
+#define OCT  8
+#define BIN  2
+
+template <class A, class B>
+constexpr typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <class A, class B>
+constexpr typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* buf);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const char* s)     { return write(s); }
+    size_t print(char c)            { return write((uint8_t)c); }
+    size_t print(int n, int base = DEC)                { return printSigned(n, base); }
+    size_t print(long n, int base = DEC)               { return printSigned(n, base); }
+    size_t print(long long n, int base = DEC)          { return printSigned(n, base); }
+    size_t print(unsigned n, int base = DEC)           { return printUnsigned(n, base); }
+    size_t print(unsigned long n, int base = DEC)      { return printUnsigned(n, base); }
+    size_t print(unsigned long long n, int base = DEC) { return printUnsigned(n, base); }
+    size_t print(double v, int digits = 2);
+
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+    template <class T> size_t println(T v)           { size_t n = print(v);       return n + println(); }
+    template <class T> size_t println(T v, int fmt)  { size_t n = print(v, fmt);  return n + println(); }
+
+private:
+    size_t printSigned(long long n, int base);
+    size_t printUnsigned(unsigned long long n, int base);
+};
+
+// stdout for output, non-blocking stdin for single-key commands.
+class Console : public Print {
+public:
+    void   begin(long) {}
+    int    available();
+    int    read();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    using Print::write;
+    explicit operator bool() const { return true; }
+    bool   muted = false;   // drop output (benchmarks)
+};
+
+extern Console Serial;
@@ -0,0 +1,276 @@
+// ============================================================
+//  native/hal_posix.cpp
+// ============================================================
+#include "hal_posix.h"
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// ─── Clock / RTC ────────────────────────────────────────────
+static uint64_t steadyUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t PosixClock::millis() { return (uint32_t)(steadyUs() / 1000); }
+uint32_t PosixClock::micros() { return (uint32_t)steadyUs(); }
+
+static int64_t localNow() {
+    time_t t = time(nullptr);
+    struct tm lt;
+    localtime_r(&t, &lt);
+    return (int64_t)t + lt.tm_gmtoff;
+}
+
+uint32_t PosixRtc::get()           { return (uint32_t)(localNow() + offset); }
+void     PosixRtc::set(uint32_t t) { offset = (int64_t)t - localNow(); }
+
+// ─── FdEcuPort ──────────────────────────────────────────────
+bool FdEcuPort::openPath(const char* p) {
+    path = p;
+    int f = ::open(p, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (f < 0) return false;
+    if (isatty(f)) {
+        struct termios tio;
+        tcgetattr(f, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(f, TCSANOW, &tio);
+    }
+    attachFd(f);
+    return true;
+}
+
+void FdEcuPort::attachFd(int f) {
+    fd = f;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    rxHead = rxTail = 0;
+}
+
+void FdEcuPort::hangUp() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    rxHead = rxTail = 0;
+}
+
+void FdEcuPort::fill() {
+    if (fd < 0) return;
+    if (rxTail == rxHead) rxHead = rxTail = 0;
+    if (rxHead == sizeof(rx)) return;
+    ssize_t n = ::read(fd, rx + rxHead, sizeof(rx) - rxHead);
+    if (n > 0) rxHead += n;
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) hangUp();
+}
+
+int FdEcuPort::available() { fill(); return (int)(rxHead - rxTail); }
+
+int FdEcuPort::read() {
+    if (rxTail == rxHead) fill();
+    return rxTail < rxHead ? rx[rxTail++] : -1;
+}
+
+size_t FdEcuPort::read(uint8_t* buf, size_t n) {
+    fill();
+    size_t k = min(n, rxHead - rxTail);
+    memcpy(buf, rx + rxTail, k);
+    rxTail += k;
+    return k;
+}
+
+size_t FdEcuPort::write(const uint8_t* buf, size_t n) {
+    size_t done = 0;
+    while (fd >= 0 && done < n) {
+        ssize_t w = ::write(fd, buf + done, n - done);
+        if (w > 0) { done += w; continue; }
+        if (w < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        hangUp();
+    }
+    return done;
+}
+
+static void setModemLine(int fd, int bit, bool on) {
+    if (fd >= 0 && isatty(fd)) ioctl(fd, on ? TIOCMBIS : TIOCMBIC, &bit);
+}
+void FdEcuPort::setDTR(bool on) { setModemLine(fd, TIOCM_DTR, on); }
+void FdEcuPort::setRTS(bool on) { setModemLine(fd, TIOCM_RTS, on); }
+
+// Like a USB re-enumeration: after a hang-up, retry the path every 500 ms.
+void FdEcuPort::task() {
+    if (fd >= 0 || path.empty()) return;
+    uint32_t now = (uint32_t)(steadyUs() / 1000);
+    if (now - retryMs < 500) return;
+    retryMs = now;
+    openPath(path.c_str());
+}
+
+// ─── FdTelemetry ────────────────────────────────────────────
+int FdTelemetry::availableForWrite() {
+    if (fd < 0) {
+        uint32_t now = (uint32_t)(steadyUs() / 1000);
+        if (retryMs && now - retryMs < 500) return 0;
+        retryMs = now;
+        struct stat st;
+        fifo = stat(path.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+        fd = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | (fifo ? 0 : O_CREAT | O_TRUNC), 0644);
+        if (fd < 0) return 0;   // FIFO without a reader yet
+    }
+    if (!fifo) return 1 << 16;
+    int used = 0;
+    ioctl(fd, FIONREAD, &used);
+    return fcntl(fd, F_GETPIPE_SZ) - used;
+}
+
+size_t FdTelemetry::write(const uint8_t* buf, size_t n) {
+    ssize_t w = fd >= 0 ? ::write(fd, buf, n) : -1;
+    if (w < 0 && errno != EAGAIN) { if (fd >= 0) ::close(fd); fd = -1; }   // reader gone
+    return w > 0 ? (size_t)w : 0;
+}
+
+// ─── MemEcuPort ─────────────────────────────────────────────
+size_t MemEcuPort::read(uint8_t* buf, size_t n) {
+    size_t k = min(n, rx.size() - rxPos);
+    memcpy(buf, rx.data() + rxPos, k);
+    rxPos += k;
+    if (rxPos == rx.size()) { rx.clear(); rxPos = 0; }
+    return k;
+}
+
+size_t MemEcuPort::write(const uint8_t* buf, size_t n) {
+    tx.insert(tx.end(), buf, buf + n);
+    if (onWrite) onWrite(*this);
+    return n;
+}
+
+// ─── PosixStorage ───────────────────────────────────────────
+class PosixFileHandle : public FileHandle {
+public:
+    FILE* fp = nullptr;
+
+    int read() override { return fgetc(fp); }
+    int read(void* buf, size_t n) override { return (int)fread(buf, 1, n, fp); }
+    // stdio accepts into its buffer and fails later; report that like a
+    // card would, as a write that took nothing.
+    size_t write(const uint8_t* buf, size_t n) override {
+        size_t w = fwrite(buf, 1, n, fp);
+        return ferror(fp) ? 0 : w;
+    }
+    void flush() override { fflush(fp); }
+    uint64_t size() override {
+        fflush(fp);
+        struct stat st;
+        return fstat(fileno(fp), &st) == 0 ? (uint64_t)st.st_size : 0;
+    }
+    uint64_t position() override { return (uint64_t)ftello(fp); }
+    bool seek(uint64_t pos) override { return fseeko(fp, (off_t)pos, SEEK_SET) == 0; }
+    bool preAllocate(uint64_t bytes) override {
+        return fallocate(fileno(fp), FALLOC_FL_KEEP_SIZE, 0, (off_t)bytes) == 0;
+    }
+    bool truncate() override {
+        fflush(fp);
+        return ftruncate(fileno(fp), ftello(fp)) == 0;
+    }
+    using FileHandle::write;
+};
+
+static PosixFileHandle posixPool[8];
+
+bool PosixStorage::exists(const char* path) { struct stat st; return stat(full(path).c_str(), &st) == 0; }
+bool PosixStorage::mkdir(const char* path)  { return ::mkdir(full(path).c_str(), 0755) == 0; }
+bool PosixStorage::remove(const char* path) { return ::remove(full(path).c_str()) == 0; }
+
+FileHandle* PosixStorage::open(const char* path, FileMode mode) {
+    for (PosixFileHandle& h : posixPool) {
+        if (h.fp) continue;
+        std::string p = full(path);
+        if (mode == FileMode::Read) {
+            h.fp = fopen(p.c_str(), "rb");
+        } else if (mode == FileMode::Overwrite) {
+            h.fp = fopen(p.c_str(), "w+b");
+        } else {
+            // SD FILE_WRITE: read/write, created if missing, positioned at the end
+            int fd = ::open(p.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd >= 0 && !(h.fp = fdopen(fd, "r+b"))) ::close(fd);
+            if (h.fp) fseeko(h.fp, 0, SEEK_END);
+        }
+        return h.fp ? &h : nullptr;
+    }
+    return nullptr;
+}
+
+void PosixStorage::close(FileHandle* f) {
+    PosixFileHandle* h = static_cast<PosixFileHandle*>(f);
+    if (h && h->fp) { fclose(h->fp); h->fp = nullptr; }
+}
+
+// The filesystem block size stands in for the FAT/exFAT cluster.
+uint32_t PosixStorage::clusterBytes() {
+    struct statvfs v;
+    return statvfs(root.c_str(), &v) == 0 ? (uint32_t)v.f_bsize : 0;
+}
+
+// ─── MemStorage ─────────────────────────────────────────────
+class MemFileHandle : public FileHandle {
+public:
+    std::vector<uint8_t>* data = nullptr;
+    size_t                pos  = 0;
+    uint64_t*             counter = nullptr;
+
+    int read() override { return pos < data->size() ? (*data)[pos++] : -1; }
+    int read(void* buf, size_t n) override {
+        size_t k = min(n, data->size() - min(pos, data->size()));
+        memcpy(buf, data->data() + pos, k);
+        pos += k;
+        return (int)k;
+    }
+    size_t write(const uint8_t* buf, size_t n) override {
+        if (pos + n > data->size()) data->resize(pos + n);
+        memcpy(data->data() + pos, buf, n);
+        pos += n;
+        *counter += n;
+        return n;
+    }
+    void flush() override {}
+    uint64_t size() override { return data->size(); }
+    uint64_t position() override { return pos; }
+    bool seek(uint64_t p) override { if (p > data->size()) return false; pos = p; return true; }
+    using FileHandle::write;
+};
+
+static MemFileHandle memPool[8];
+
+bool MemStorage::exists(const char* path) { return files.count(path) || dirs.count(path); }
+bool MemStorage::mkdir(const char* path)  { if (exists(path)) return false; dirs[path] = true; return true; }
+bool MemStorage::remove(const char* path) { return files.erase(path) > 0; }
+
+FileHandle* MemStorage::open(const char* path, FileMode mode) {
+    auto it = files.find(path);
+    if (mode == FileMode::Read && it == files.end()) return nullptr;
+    for (MemFileHandle& h : memPool) {
+        if (h.data) continue;
+        std::vector<uint8_t>& v = files[path];
+        if (mode == FileMode::Overwrite) v.clear();
+        h.data    = &v;
+        h.pos     = mode == FileMode::Append ? v.size() : 0;
+        h.counter = &bytesWritten;
+        return &h;
+    }
+    return nullptr;
+}
+
+void MemStorage::close(FileHandle* f) {
+    if (f) static_cast<MemFileHandle*>(f)->data = nullptr;
+}
+
+void MemStorage::put(const char* path, const std::string& data) {
+    files[path].assign(data.begin(), data.end());
+}
+
+std::vector<uint8_t>* MemStorage::get(const char* path) {
+    auto it = files.find(path);
+    return it == files.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,126 @@
+// ============================================================
+//  native/hal_posix.h — hal.h on Linux
+// ============================================================
+//
+//  PosixClock    steady_clock millis()/micros()
+//  PosixRtc      wall clock in local time; set() keeps an offset
+//  FdEcuPort     tty, pty or socket fd (raw mode, non-blocking)
+//  MemEcuPort    in-process byte queues for benchmarks
+//  PosixStorage  a directory standing in for the SD root
+//  MemStorage    RAM-backed files, no disk I/O at all
+//  FdTelemetry   live stream into a file or FIFO
+// ============================================================
+#pragma once
+
+#include "../hal.h"
+#include <map>
+#include <string>
+#include <vector>
+
+class PosixClock : public Clock {
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+};
+
+class PosixRtc : public Rtc {
+public:
+    uint32_t get() override;
+    void     set(uint32_t t) override;
+private:
+    int64_t offset = 0;
+};
+
+class FdEcuPort : public EcuPort {
+public:
+    bool   openPath(const char* path);   // reopened from task() after a hang-up
+    void   attachFd(int fd);             // e.g. one end of a socketpair
+
+    bool   connected() override { return fd >= 0; }
+    int    available() override;
+    int    read() override;
+    size_t read(uint8_t* buf, size_t n) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    void   setDTR(bool on) override;
+    void   setRTS(bool on) override;
+    void   task() override;
+
+private:
+    void   fill();
+    void   hangUp();
+
+    int         fd = -1;
+    std::string path;
+    uint32_t    retryMs = 0;
+    uint8_t     rx[8192];
+    size_t      rxHead = 0, rxTail = 0;
+};
+
+// Bytes written by the logger land in `tx`; bytes queued into `rx`
+// are what the logger reads. `onWrite` lets a simulator answer inline.
+class MemEcuPort : public EcuPort {
+public:
+    std::vector<uint8_t> rx, tx;
+    size_t rxPos = 0;
+    bool   link  = true;
+    void (*onWrite)(MemEcuPort& port) = nullptr;
+
+    bool   connected() override { return link; }
+    int    available() override { return (int)(rx.size() - rxPos); }
+    int    read() override      { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+    size_t read(uint8_t* buf, size_t n) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    void   setDTR(bool) override {}
+    void   setRTS(bool) override {}
+};
+
+// A FIFO is opened once a reader appears and reopened after it leaves;
+// its room is what the pipe buffer still holds, so a slow reader makes
+// records drop instead of stalling the logger.
+class FdTelemetry : public TelemetryPort {
+public:
+    explicit FdTelemetry(const char* path) : path(path) {}
+
+    int    availableForWrite() override;
+    size_t write(const uint8_t* buf, size_t n) override;
+
+private:
+    std::string path;
+    int         fd = -1;
+    bool        fifo = false;
+    uint32_t    retryMs = 0;
+};
+
+class PosixStorage : public Storage {
+public:
+    explicit PosixStorage(const char* root) : root(root) {}
+
+    bool        exists(const char* path) override;
+    bool        mkdir(const char* path) override;
+    bool        remove(const char* path) override;
+    FileHandle* open(const char* path, FileMode mode) override;
+    void        close(FileHandle* f) override;
+    uint32_t    clusterBytes() override;
+
+private:
+    std::string full(const char* path) const { return root + "/" + path; }
+    std::string root;
+};
+
+class MemStorage : public Storage {
+public:
+    bool        exists(const char* path) override;
+    bool        mkdir(const char* path) override;
+    bool        remove(const char* path) override;
+    FileHandle* open(const char* path, FileMode mode) override;
+    void        close(FileHandle* f) override;
+
+    // Pre-load a file (e.g. an INI) or inspect one the logger wrote.
+    void                  put(const char* path, const std::string& data);
+    std::vector<uint8_t>* get(const char* path);
+    uint64_t              bytesWritten = 0;
+
+private:
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::map<std::string, bool>                 dirs;
+};
@@ -0,0 +1,147 @@
+// ============================================================
+//  native/main_native.cpp — host build of the logger
+// ============================================================
+//
+//  Runs the same core as the Teensy (logger, ini, scheduler, prof) against
+//  a tty / pty / socket instead of the USB host port and a directory
+//  instead of the SD card:
+//
+//    program --port /dev/pts/7 --sd ./sdcard [--seconds 60] [--poll-ms 10] [--spin]
+//    program --fd 3 --ram ...          (socketpair end, RAM storage)
+//
+//  Serial commands (t, s, u, p, b, l, q) are read from stdin.
+// ============================================================
+#include "hal_posix.h"
+#include "../logger.h"
+#include "../prof.h"
+#include "../scheduler.h"
+#include "../sdbench.h"
+#include "../telem.h"
+#include <signal.h>
+#include <unistd.h>
+
+static PosixClock   posixClock;
+static PosixRtc     posixRtc;
+static FdEcuPort    fdEcu;
+static MemStorage   memStorage;
+static PosixStorage* posixStorage = nullptr;
+
+Hal hal = { &posixClock, &posixRtc, &fdEcu, nullptr, nullptr, nullptr, nullptr };
+
+static void taskEcuLink() { hal.ecu->task(); }
+
+static void taskCmd() {
+    int c = Serial.read();
+    if (c >= 0) loggerCommand((char)c);
+}
+
+static Task tasks[] = {
+    //  name    run              period  budget  deferable
+    { "ecu",  loggerStep,          0,    500,  false },
+    { "usb",  taskEcuLink,         0,    200,  false },
+    { "sd",   loggerDrainTask,     0,   3000,  true  },
+    { "bench", sdBenchTask,        0,   5000,  false },
+    { "tlm",  telemTask,       10000,    200,  true  },
+    { "cmd",  taskCmd,         10000,    500,  false },
+};
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s (--port PATH | --fd N) (--sd DIR | --ram [--ini FILE]) [options]\n"
+        "  --port PATH  tty / pty of the ECU (reopened after a hang-up)\n"
+        "  --fd N       already-open socket or pty fd\n"
+        "  --sd DIR     directory used as the SD card root (INI + logs)\n"
+        "  --ram        in-memory card; logs are discarded at exit\n"
+        "  --ini FILE   with --ram: load FILE as DEFAULT.INI\n"
+        "  --seconds N  stop logging and print 'u' + 'p' reports after N s\n"
+        "  --poll-ms N  'O' period in ms (default %lu; 0 = back to back)\n"
+        "  --sync-ms N  max age of unsynced rows (default %lu)\n"
+        "  --sync-clusters N  also sync every N clusters written (default %lu; 0 = age only)\n"
+        "  --spin       never sleep between passes (max-rate benchmarks)\n"
+        "  --no-rtc     treat the clock as unset (sequential LOGnnn.msl names)\n"
+        "  --blackbox   log only around triggers ('x' on stdin forces one)\n"
+        "  --auto       one log per session, opened/closed on START_WHEN / STOP_WHEN\n"
+        "  --sparse     change-of-value binary logs (.tsb; tools/expand makes .msl)\n"
+        "  --telemetry PATH  live records into a file or FIFO (see telem.h)\n",
+        argv0, (unsigned long)POLL_INTERVAL_MS, (unsigned long)SYNC_INTERVAL_MS, (unsigned long)SYNC_CLUSTERS);
+}
+
+int main(int argc, char** argv) {
+    const char* port = nullptr;
+    const char* sd   = nullptr;
+    const char* ini  = nullptr;
+    const char* telemetry = nullptr;
+    int  fd      = -1;
+    bool ram     = false;
+    bool spin    = false;
+    bool noRtc   = false;
+    long seconds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if      (!strcmp(a, "--port")    && more) port    = argv[++i];
+        else if (!strcmp(a, "--fd")      && more) fd      = atoi(argv[++i]);
+        else if (!strcmp(a, "--sd")      && more) sd      = argv[++i];
+        else if (!strcmp(a, "--ini")     && more) ini     = argv[++i];
+        else if (!strcmp(a, "--telemetry") && more) telemetry = argv[++i];
+        else if (!strcmp(a, "--seconds") && more) seconds = atol(argv[++i]);
+        else if (!strcmp(a, "--poll-ms") && more) pollIntervalMs = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--sync-ms") && more) syncIntervalMs = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--sync-clusters") && more) syncClusters = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--ram"))             ram     = true;
+        else if (!strcmp(a, "--spin"))            spin    = true;
+        else if (!strcmp(a, "--no-rtc"))          noRtc   = true;
+        else if (!strcmp(a, "--blackbox"))        blackboxMode = true;
+        else if (!strcmp(a, "--auto"))            autoSession  = true;
+        else if (!strcmp(a, "--sparse"))          sparseLog    = true;
+        else { usage(argv[0]); return 2; }
+    }
+    if ((!port && fd < 0) || (!sd && !ram)) { usage(argv[0]); return 2; }
+
+    if (ram) {
+        hal.fs = &memStorage;
+        if (ini) {
+            FILE* f = fopen(ini, "rb");
+            if (!f) { perror(ini); return 1; }
+            std::string text;
+            char buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+            fclose(f);
+            memStorage.put("DEFAULT.INI", text);
+        }
+    } else {
+        posixStorage = new PosixStorage(sd);
+        hal.fs = posixStorage;
+    }
+    if (port && !fdEcu.openPath(port)) { perror(port); return 1; }
+    if (fd >= 0) fdEcu.attachFd(fd);
+    if (telemetry) {
+        signal(SIGPIPE, SIG_IGN);   // a FIFO reader may go away
+        hal.telemetry = new FdTelemetry(telemetry);
+        telemetryOn   = true;
+    }
+
+    profInit();
+    Serial.println("[HOST] TeensyTSLogger native build");
+    rtcOK = !noRtc;
+    loggerBegin(true);
+    schedBegin(tasks, sizeof(tasks) / sizeof(tasks[0]));
+
+    const uint32_t startMs = halMillis();
+    for (;;) {
+        schedLoop();
+        if (seconds > 0 && halMillis() - startMs >= (uint32_t)seconds * 1000) {
+            loggerCommand('s');
+            loggerCommand('u');
+            loggerCommand('p');
+            if (ram) {
+                Serial.print("[HOST] Bytes written: "); Serial.println((unsigned long)memStorage.bytesWritten);
+            }
+            break;
+        }
+        if (!spin) usleep(50);
+    }
+    return 0;
+}
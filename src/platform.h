@@ -0,0 +1,11 @@
+// ============================================================
+//  platform.h — Arduino core on the Teensy, a minimal stand-in
+//  (Print, Serial console, dtostrf, min/max) on a host build
+// ============================================================
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "native/arduino_compat.h"
+#endif
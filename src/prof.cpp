@@ -0,0 +1,62 @@
+// ============================================================
+//  prof.cpp — stage histogram storage and the 'p' report
+// ============================================================
+#include "prof.h"
+#include "platform.h"
+
+#ifndef DISABLE_PROFILING
+
+ProfHist profHist[PS_COUNT];
+
+static const char* const STAGE_NAMES[PS_COUNT] = {
+    "send", "first", "last", "decode", "format", "append", "sdwrite", "flush"
+};
+
+void profInit() {
+#ifdef ARDUINO
+    ARM_DEMCR    |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+    memset(profHist, 0, sizeof(profHist));
+}
+
+static void printUs(float us) {
+    char buf[16];
+    dtostrf(us, 9, 1, buf);
+    Serial.print(buf);
+}
+
+void profPrintAndReset() {
+    const float tpu = profTicksPerUs();
+    Serial.println("[PROF] stage          n    min us   mean us    max us");
+    for (uint8_t s = 0; s < PS_COUNT; s++) {
+        const ProfHist& h = profHist[s];
+        char head[32];
+        snprintf(head, sizeof(head), "[PROF] %-7s %8lu ", STAGE_NAMES[s], (unsigned long)h.n);
+        Serial.print(head);
+        if (h.n == 0) { Serial.println("        -"); continue; }
+        printUs(h.min / tpu); Serial.print(' ');
+        printUs((float)h.sum / h.n / tpu); Serial.print(' ');
+        printUs(h.max / tpu);
+        Serial.println();
+
+        // One line per stage: "<upper bound us>:count" for non-empty buckets
+        Serial.print("[PROF]   ");
+        for (uint8_t b = 0; b < 32; b++) {
+            if (!h.bucket[b]) continue;
+            char bb[40], ub[16];
+            dtostrf((float)(2.0 * (1u << b)) / tpu, 1, 1, ub);
+            snprintf(bb, sizeof(bb), " <%s:%lu", ub, (unsigned long)h.bucket[b]);
+            Serial.print(bb);
+        }
+        Serial.println();
+    }
+    memset(profHist, 0, sizeof(profHist));
+}
+
+#else
+
+void profInit() {}
+void profPrintAndReset() { Serial.println("[PROF] Built with DISABLE_PROFILING."); }
+
+#endif
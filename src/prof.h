@@ -0,0 +1,77 @@
+// ============================================================
+//  prof.h — hot-path stage timing
+// ============================================================
+//
+//  PROF_BEGIN(t) / PROF_END(stage, t) bracket one stage of the poll →
+//  SD pipeline; PROF_STAMP(v) stores a start time that outlives the
+//  current scope (e.g. request sent → reply complete). Each stage
+//  keeps n / min / max / sum plus a log2 histogram (bucket k counts
+//  samples in [2^k, 2^(k+1)) ticks).
+//
+//  Ticks are DWT CYCCNT cycles on the Teensy and steady_clock
+//  nanoseconds on a host build. Build with -D DISABLE_PROFILING and
+//  the macros expand to nothing — no counters, no tables.
+// ============================================================
+#pragma once
+
+#include <stdint.h>
+
+enum ProfStage : uint8_t {
+    PS_SEND,        // frame + write 'O' request
+    PS_FIRST_BYTE,  // request → first reply byte
+    PS_LAST_BYTE,   // request → reply complete
+    PS_DECODE,      // blob → values[]
+    PS_FORMAT,      // values[] → MSL text
+    PS_APPEND,      // row → SD staging ring
+    PS_SD_WRITE,    // ring chunk → File::write
+    PS_FLUSH,       // File::flush
+    PS_COUNT
+};
+
+#ifndef DISABLE_PROFILING
+
+#ifdef ARDUINO
+#include "platform.h"
+static inline uint32_t profNow() { return ARM_DWT_CYCCNT; }
+// F_CPU_ACTUAL is a variable on Teensy 4 (set_arm_clock() changes it).
+static inline float profTicksPerUs() { return F_CPU_ACTUAL / 1e6f; }
+#else
+#include <chrono>
+static inline uint32_t profNow() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static inline float profTicksPerUs() { return 1000.0f; }
+#endif
+
+struct ProfHist {
+    uint32_t n, min, max;
+    uint64_t sum;
+    uint32_t bucket[32];
+};
+
+extern ProfHist profHist[PS_COUNT];
+
+static inline void profRecord(ProfStage s, uint32_t ticks) {
+    ProfHist& h = profHist[s];
+    if (h.n == 0 || ticks < h.min) h.min = ticks;
+    if (ticks > h.max)             h.max = ticks;
+    h.n++;
+    h.sum += ticks;
+    h.bucket[31 - __builtin_clz(ticks | 1)]++;
+}
+
+#define PROF_BEGIN(t)        const uint32_t t = profNow()
+#define PROF_END(stage, t)   profRecord(stage, profNow() - (t))
+#define PROF_STAMP(v)        ((v) = profNow())
+
+#else
+
+#define PROF_BEGIN(t)        do {} while (0)
+#define PROF_END(stage, t)   do {} while (0)
+#define PROF_STAMP(v)        do {} while (0)
+
+#endif
+
+void profInit();
+void profPrintAndReset();
@@ -0,0 +1,200 @@
+// ============================================================
+//  rates.cpp — per-channel poll rate groups
+// ============================================================
+#include "rates.h"
+#include "hal.h"
+#include "ini.h"
+
+static const char* const RATES_CONFIG = "RATES.CFG";
+
+struct RateGroup {
+    uint32_t periodMs;                     // 0 for the full block (caller's fullMs)
+    OchRange ranges[RATE_MAX_RANGES];
+    uint8_t  numRanges;
+    uint16_t numChannels;
+    uint32_t lastMs;                       // when its last poll started
+};
+
+static RateGroup groups[RATE_MAX_GROUPS + 1];   // [0] is the full block
+static uint8_t   numGroups    = 1;
+static uint32_t  fullPeriodMs = 0;              // 0 = caller's default
+static bool      primed       = false;          // full block read at least once
+static int8_t    current      = -1;             // group being polled, -1 = idle
+static uint8_t   currentRange = 0;
+
+static int8_t    chanGroup[MAX_CHANNELS];       // RATES.CFG group per channel, -1 = none
+static uint8_t   byteMask[OCH_BUF_SIZE];
+
+static uint8_t tcSize(TypeCode tc) {
+    switch (tc) {
+        case TC_U08: case TC_S08: return 1;
+        case TC_U16: case TC_S16: return 2;
+        default:                  return 4;
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Range building
+// ─────────────────────────────────────────────────────────────
+// Runs of marked bytes, joined across gaps of up to maxGap unmarked
+// bytes. Returns the run count even past RATE_MAX_RANGES.
+static uint8_t buildRuns(uint16_t maxGap, OchRange* out) {
+    uint8_t  n = 0;
+    int32_t  start = -1, last = -1;
+    for (uint16_t b = 0; b < ochBlockSize; b++) {
+        if (!byteMask[b]) continue;
+        if (start >= 0 && b - last - 1 > maxGap) {
+            if (n < RATE_MAX_RANGES) out[n] = { (uint16_t)start, (uint16_t)(last - start + 1) };
+            n++;
+            start = -1;
+        }
+        if (start < 0) start = b;
+        last = b;
+    }
+    if (start >= 0) {
+        if (n < RATE_MAX_RANGES) out[n] = { (uint16_t)start, (uint16_t)(last - start + 1) };
+        n++;
+    }
+    return n;
+}
+
+static void buildGroup(uint8_t g) {
+    RateGroup& grp = groups[g];
+    memset(byteMask, 0, ochBlockSize);
+    for (uint16_t i = 0; i < numChannels; i++) {
+        if (chanGroup[i] != (int8_t)g) continue;
+        const Channel& ch = channels[i];
+        if (ch.dk == DK_EXPR) continue;    // computed from whatever was read
+        for (uint8_t k = 0; k < tcSize(ch.tc) && ch.offset + k < ochBlockSize; k++) byteMask[ch.offset + k] = 1;
+    }
+    // A request costs ~18 bytes of framing, so joining small gaps is
+    // cheaper than splitting; widen the join until the ranges fit.
+    uint16_t gap = RATE_MERGE_GAP;
+    while ((grp.numRanges = buildRuns(gap, grp.ranges)) > RATE_MAX_RANGES) gap *= 2;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Config
+// ─────────────────────────────────────────────────────────────
+static int8_t groupFor(uint32_t periodMs) {
+    for (uint8_t g = 1; g < numGroups; g++) if (groups[g].periodMs == periodMs) return g;
+    if (numGroups > RATE_MAX_GROUPS) return -1;
+    RateGroup& grp = groups[numGroups];
+    memset(&grp, 0, sizeof(grp));
+    grp.periodMs = periodMs;
+    return numGroups++;
+}
+
+static void loadConfig() {
+    FileHandle* f = hal.fs->open(RATES_CONFIG, FileMode::Read);
+    if (!f) return;
+    char line[96];
+    while (readLine(f, line, sizeof(line))) {
+        char* sc = strchr(line, ';');
+        if (sc) *sc = '\0';
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        char* name = line;
+        while (*name == ' ' || *name == '\t') name++;
+        trimRight(name);
+        uint32_t period = (uint32_t)atol(eq + 1);
+        if (!*name || !period) continue;
+
+        if (!strcmp(name, "full")) { fullPeriodMs = period; continue; }
+        int16_t ch = findChannelByName(name);
+        if (ch < 0) { Serial.print("[RATE] Channel not in INI: "); Serial.println(name); continue; }
+        int8_t g = groupFor(period);
+        if (g < 0) {
+            Serial.print("[RATE] More than "); Serial.print(RATE_MAX_GROUPS);
+            Serial.print(" periods, ignoring "); Serial.println(name);
+            continue;
+        }
+        chanGroup[ch] = g;
+        groups[g].numChannels++;
+    }
+    hal.fs->close(f);
+}
+
+void ratesBegin() {
+    numGroups    = 1;
+    fullPeriodMs = 0;
+    primed       = false;
+    current      = -1;
+    memset(chanGroup, -1, sizeof(chanGroup));
+    groups[0] = {};
+    groups[0].ranges[0]  = { 0, ochBlockSize };
+    groups[0].numRanges  = 1;
+    groups[0].numChannels = numChannels;
+    loadConfig();
+    if (numGroups > 1 && !ochCommand.ranged()) {
+        Serial.println("[RATE] ochGetCommand has no %o/%c, polling the full block only");
+        numGroups = 1;
+    }
+
+    for (uint8_t g = 1; g < numGroups; g++) {
+        buildGroup(g);
+        uint32_t bytes = 0;
+        for (uint8_t r = 0; r < groups[g].numRanges; r++) bytes += groups[g].ranges[r].count;
+        Serial.print("[RATE] "); Serial.print(groups[g].periodMs); Serial.print(" ms: ");
+        Serial.print(groups[g].numChannels); Serial.print(" channels in ");
+        Serial.print(groups[g].numRanges); Serial.print(" requests, ");
+        Serial.print(bytes); Serial.print(" of "); Serial.print(ochBlockSize); Serial.println(" bytes");
+    }
+    if (numGroups > 1 || fullPeriodMs) {
+        Serial.print("[RATE] Full block every ");
+        if (fullPeriodMs) { Serial.print(fullPeriodMs); Serial.println(" ms"); }
+        else              Serial.println("poll interval");
+    }
+}
+
+uint32_t ratesFullPeriodMs(uint32_t fallbackMs) { return fullPeriodMs ? fullPeriodMs : fallbackMs; }
+
+// ─────────────────────────────────────────────────────────────
+//  Scheduling
+// ─────────────────────────────────────────────────────────────
+static uint32_t periodOf(uint8_t g, uint32_t fullMs) { return g == 0 ? fullMs : groups[g].periodMs; }
+
+bool ratesNext(uint32_t nowMs, uint32_t fullMs, bool useGroups, OchRange& r) {
+    if (current < 0) {
+        int8_t  pick = -1;
+        int32_t worst = 0;
+        if (!primed) {
+            pick = 0;
+        } else {
+            // Most overdue group first, so a slow full-block read never
+            // starves the fast groups for more than one poll.
+            uint8_t n = useGroups ? numGroups : 1;
+            for (uint8_t g = 0; g < n; g++) {
+                int32_t late = (int32_t)(nowMs - groups[g].lastMs - periodOf(g, fullMs));
+                if (late >= 0 && (pick < 0 || late > worst)) { pick = g; worst = late; }
+            }
+        }
+        if (pick < 0) return false;
+        current = pick;
+        currentRange = 0;
+        groups[pick].lastMs = nowMs;
+    }
+    r = groups[current].ranges[currentRange];
+    return true;
+}
+
+bool ratesDone(bool ok) {
+    if (current < 0) return false;
+    if (!ok) { current = -1; return false; }   // retried at its next period
+    if (++currentRange < groups[current].numRanges) return false;
+    if (current == 0) primed = true;
+    current = -1;
+    return true;
+}
+
+uint32_t ratesSlackMs(uint32_t nowMs, uint32_t fullMs, bool useGroups) {
+    if (current >= 0 || !primed) return 0;
+    uint32_t slack = UINT32_MAX;
+    uint8_t  n = useGroups ? numGroups : 1;
+    for (uint8_t g = 0; g < n; g++) {
+        uint32_t since = nowMs - groups[g].lastMs, period = periodOf(g, fullMs);
+        slack = min(slack, since >= period ? 0 : period - since);
+    }
+    return slack;
+}
@@ -0,0 +1,36 @@
+// ============================================================
+//  rates.h — per-channel poll rate groups
+// ============================================================
+//
+//  By default every poll pulls the whole output block. /RATES.CFG
+//  moves channels into faster groups, each polled with its own
+//  'O' offset/count ranges at its own period:
+//
+//    full     = 1000        ; whole block every 1 s (default: poll rate)
+//    RPMValue = 10          ; channel = period in ms
+//    MAPValue = 10
+//    TPSValue = 10
+//
+//  Channels with the same period form a group. A group's channels are
+//  merged into at most RATE_MAX_RANGES byte ranges (nearby channels
+//  share a request), requested back to back. Every poll updates the
+//  blob in place, so a row always carries the last-known value of the
+//  slower channels. The first poll after ratesBegin() is always the
+//  full block, so no row ever holds unread zeros.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+struct OchRange { uint16_t offset, count; };
+
+void     ratesBegin();                   // load RATES.CFG against the parsed INI
+uint32_t ratesFullPeriodMs(uint32_t fallbackMs);   // 'full' from RATES.CFG, else fallbackMs
+
+// Range to request at nowMs, or false if nothing is due. The full block
+// is due every fullMs; groups only run when `groups` is set.
+bool     ratesNext(uint32_t nowMs, uint32_t fullMs, bool groups, OchRange& r);
+// The range from ratesNext() arrived (true) or failed (false). Returns
+// true when that completed a poll — time to write a row.
+bool     ratesDone(bool ok);
+uint32_t ratesSlackMs(uint32_t nowMs, uint32_t fullMs, bool groups);   // until the next poll is due
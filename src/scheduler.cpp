@@ -0,0 +1,115 @@
+// ============================================================
+//  scheduler.cpp — cooperative scheduler and loop-budget accounting
+// ============================================================
+#include "scheduler.h"
+#include "config.h"
+#include "hal.h"
+#include "logger.h"
+
+static Task*    tasks    = nullptr;
+static uint8_t  numTasks = 0;
+static uint32_t schedResetUs = 0;   // start of the current 'u' window
+
+// ─── Loop budget ────────────────────────────────────────────
+static uint32_t loopOverruns    = 0;   // passes that exceeded LOOP_BUDGET_US
+static uint32_t loopWorstUs     = 0;   // longest pass since last report
+static State    loopWorstState  = State::WaitDevice;
+static uint32_t loopReportMs    = 0;
+static uint32_t loopReported    = 0;   // loopOverruns at last report
+
+void schedBegin(Task* t, uint8_t count) {
+    tasks        = t;
+    numTasks     = count;
+    schedResetUs = halMicros();
+}
+
+// Every wait in the state machine is a timed sub-state, so a pass should
+// stay well under LOOP_BUDGET_US. Overruns are counted and reported at
+// most once a second so the report itself stays cheap.
+static void checkLoopBudget(State s, uint32_t elapsedUs) {
+    if (elapsedUs > LOOP_BUDGET_US) {
+        loopOverruns++;
+        if (elapsedUs > loopWorstUs) { loopWorstUs = elapsedUs; loopWorstState = s; }
+    }
+    if (loopOverruns != loopReported && halMillis() - loopReportMs >= 1000) {
+        Serial.print("[LOOP] "); Serial.print(loopOverruns - loopReported);
+        Serial.print(" pass(es) over "); Serial.print(LOOP_BUDGET_US);
+        Serial.print(" us, worst "); Serial.print(loopWorstUs);
+        Serial.print(" us in "); Serial.print(stateName(loopWorstState));
+        Serial.print("  (total "); Serial.print(loopOverruns); Serial.println(")");
+        loopReported = loopOverruns;
+        loopReportMs = halMillis();
+        loopWorstUs  = 0;
+    }
+}
+
+// ─── Passes ─────────────────────────────────────────────────
+static uint32_t passUs    = 0;       // start of the pass (or of the span since the last yield)
+static State    passState = State::WaitDevice;
+static bool     yielding  = false;   // inside schedYield(): no nesting
+static uint32_t yieldedUs = 0;       // total time spent in schedYield()
+
+static void runTasks() {
+    for (uint8_t i = 0; i < numTasks; i++) {
+        Task& t = tasks[i];
+        if (t.running) continue;
+        uint32_t t0 = halMicros();
+        if (t.periodUs && t0 - t.lastUs < t.periodUs) continue;
+        if (t.deferable && loggerSlackUs() < t.budgetUs) { t.skipped++; continue; }
+        t.lastUs  = t0;
+        t.running = true;
+        uint32_t y0 = yieldedUs;
+        t.run();
+        t.running = false;
+        uint32_t dt = halMicros() - t0 - (yieldedUs - y0);   // yields are charged to the tasks they ran
+        t.runs++;
+        t.busyUs += dt;
+        if (dt > t.maxUs)    t.maxUs = dt;
+        if (dt > t.budgetUs) t.overBudget++;
+    }
+}
+
+void schedLoop() {
+    passUs    = halMicros();
+    passState = loggerState();
+    runTasks();
+    checkLoopBudget(passState, halMicros() - passUs);
+}
+
+// The span since the pass (or the last yield) began is what the ECU
+// task waited, so it is checked against the loop budget here; the
+// nested pass counts towards the next span.
+bool schedYield() {
+    if (yielding || !tasks) return false;
+    uint32_t t0 = halMicros();
+    checkLoopBudget(passState, t0 - passUs);
+    yielding  = true;
+    passUs    = t0;
+    passState = loggerState();
+    runTasks();
+    yielding  = false;
+    yieldedUs += halMicros() - t0;
+    return true;
+}
+
+void schedPrintUsage() {
+    uint32_t wallUs = halMicros() - schedResetUs;
+    char line[80];
+    Serial.print("[CPU] "); Serial.print(wallUs / 1000); Serial.println(" ms window");
+    Serial.println("[CPU] task      runs  busy%   avg us   max us  over  skip");
+    for (uint8_t i = 0; i < numTasks; i++) {
+        Task& t = tasks[i];
+        float pct = wallUs ? 100.0f * (float)t.busyUs / (float)wallUs : 0.0f;
+        char pbuf[8];
+        dtostrf(pct, 5, 1, pbuf);
+        snprintf(line, sizeof(line), "[CPU] %-5s %8lu  %s %8lu %8lu %5lu %5lu",
+            t.name, (unsigned long)t.runs, pbuf,
+            (unsigned long)(t.runs ? t.busyUs / t.runs : 0), (unsigned long)t.maxUs,
+            (unsigned long)t.overBudget, (unsigned long)t.skipped);
+        Serial.println(line);
+        t.runs = t.skipped = t.overBudget = t.maxUs = 0;
+        t.busyUs = 0;
+    }
+    loggerPrintBufferStats();
+    schedResetUs = halMicros();
+}
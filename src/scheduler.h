@@ -0,0 +1,37 @@
+// ============================================================
+//  scheduler.h — cooperative scheduler
+// ============================================================
+//
+//  Tasks run in table order (= priority) each pass. A task with a
+//  period only runs once that much time has passed; a deferable task
+//  is skipped while the next ECU poll is due sooner than its budget,
+//  so MTP and the SD drain only ever use slack between polls. Each run
+//  is timed; 'u' prints per-task CPU share since the last report.
+//
+//  A task stuck in a library loop it cannot return from (an MTP file
+//  transfer) calls schedYield() between steps: the other tasks get one
+//  pass, and that time is charged to them, not to the caller.
+//
+//  The platform owns the task table and hands it to schedBegin().
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+struct Task {
+    const char* name;
+    void      (*run)();
+    uint32_t    periodUs;    // 0 = every pass
+    uint32_t    budgetUs;    // expected worst case of one run
+    bool        deferable;   // may be skipped to protect the ECU poll
+
+    bool        running = false;
+    uint32_t    lastUs = 0;
+    uint32_t    runs = 0, skipped = 0, overBudget = 0, maxUs = 0;
+    uint64_t    busyUs = 0;
+};
+
+void schedBegin(Task* tasks, uint8_t count);
+void schedLoop();          // one pass over all tasks + loop-budget check
+bool schedYield();         // one nested pass over the tasks not already running; false if nested
+void schedPrintUsage();
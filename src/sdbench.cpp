@@ -0,0 +1,262 @@
+// ============================================================
+//  sdbench.cpp — SD card self-characterisation ('b')
+// ============================================================
+#include "sdbench.h"
+#include "hal.h"
+#include "logger.h"
+
+static constexpr uint16_t BLOCK_SIZES[] = { 512, 1024, 2048, 4096, 8192, 16384, 32768 };
+static constexpr uint8_t  NUM_SIZES     = sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]);
+static constexpr uint32_t WRAP_BYTES    = 16UL << 20;   // scratch file is recreated past this
+static constexpr uint16_t LAT_SECONDS   = SDBENCH_LATENCY_MS / 1000;
+static const char* const  SCRATCH = "SDBENCH.TMP";
+static const char* const  REPORT  = "SDBENCH.TXT";
+
+DMAMEM static uint8_t benchBuf[32768];
+
+enum class Phase : uint8_t { Idle, Seq, Latency, Flush, Report };
+
+// Microsecond log2 histogram: bucket k counts samples in [2^k, 2^(k+1)).
+struct LatHist {
+    uint32_t n, maxUs;
+    uint64_t sum;
+    uint32_t bucket[32];
+
+    void add(uint32_t us) {
+        n++; sum += us;
+        if (us > maxUs) maxUs = us;
+        bucket[31 - __builtin_clz(us | 1)]++;
+    }
+    // Upper bound of the bucket holding the p-th percentile.
+    uint32_t percentile(float p) const {
+        uint32_t want = (uint32_t)(n * p / 100.0f), seen = 0;
+        for (uint8_t b = 0; b < 32; b++) {
+            seen += bucket[b];
+            if (seen > want) return (uint32_t)min((uint64_t)maxUs, 2ull << b);   // 2^32 for b = 31
+        }
+        return maxUs;
+    }
+};
+
+static Phase       phase    = Phase::Idle;
+static FileHandle* scratch  = nullptr;
+static uint8_t     sizeIdx  = 0;
+static uint32_t    written  = 0;   // bytes at the current block size / in the scratch file
+static uint64_t    busyUs   = 0;   // summed write + flush time at the current block size
+static uint32_t    startMs  = 0;
+static uint16_t    rounds   = 0;
+
+static uint32_t seqKBs[NUM_SIZES];
+static uint32_t seqMaxUs[NUM_SIZES];
+static LatHist  writeHist, flushHist;
+static uint32_t secMaxUs[LAT_SECONDS];
+static uint64_t latBytes = 0, latBusyUs = 0;
+
+// ─────────────────────────────────────────────────────────────
+//  Passes — each call performs one timed card operation
+// ─────────────────────────────────────────────────────────────
+static bool reopenScratch() {
+    if (scratch) hal.fs->close(scratch);
+    hal.fs->remove(SCRATCH);
+    scratch = hal.fs->open(SCRATCH, FileMode::Overwrite);
+    written = 0;
+    return scratch != nullptr;
+}
+
+static void fail(const char* what) {
+    Serial.print("[BENCH] "); Serial.print(what); Serial.println(" — aborted.");
+    if (scratch) { hal.fs->close(scratch); scratch = nullptr; }
+    hal.fs->remove(SCRATCH);
+    phase = Phase::Idle;
+}
+
+static uint32_t timedWrite(uint16_t n) {
+    uint32_t t0 = halMicros();
+    size_t w = scratch->write(benchBuf, n);
+    uint32_t us = halMicros() - t0;
+    if (w != n) { fail("Write failed"); return UINT32_MAX; }
+    written += n;
+    return us;
+}
+
+static void stepSeq() {
+    uint16_t bs = BLOCK_SIZES[sizeIdx];
+    uint32_t us = timedWrite(bs);
+    if (us == UINT32_MAX) return;
+    busyUs += us;
+    if (us > seqMaxUs[sizeIdx]) seqMaxUs[sizeIdx] = us;
+    if (written < SDBENCH_SEQ_BYTES) return;
+
+    uint32_t t0 = halMicros();
+    scratch->flush();
+    busyUs += halMicros() - t0;
+    seqKBs[sizeIdx] = (uint32_t)((uint64_t)written * 1000000 / max(busyUs, (uint64_t)1) / 1024);
+    Serial.print("[BENCH] seq "); Serial.print(bs); Serial.print(" B: ");
+    Serial.print(seqKBs[sizeIdx]); Serial.println(" KB/s");
+
+    if (++sizeIdx < NUM_SIZES) {
+        busyUs = 0;
+        if (!reopenScratch()) fail("Cannot recreate scratch file");
+        return;
+    }
+    if (!reopenScratch()) { fail("Cannot recreate scratch file"); return; }
+    Serial.print("[BENCH] latency: "); Serial.print(SD_CHUNK); Serial.print(" B writes for ");
+    Serial.print(SDBENCH_LATENCY_MS / 1000); Serial.println(" s...");
+    startMs = halMillis();
+    phase = Phase::Latency;
+}
+
+static void stepLatency() {
+    uint32_t elapsed = halMillis() - startMs;
+    if (elapsed >= SDBENCH_LATENCY_MS) {
+        Serial.print("[BENCH] flush: "); Serial.print(SDBENCH_FLUSH_ROUNDS); Serial.println(" write + flush rounds...");
+        if (!reopenScratch()) { fail("Cannot recreate scratch file"); return; }
+        rounds = 0;
+        phase = Phase::Flush;
+        return;
+    }
+    uint32_t us = timedWrite(SD_CHUNK);
+    if (us == UINT32_MAX) return;
+    writeHist.add(us);
+    latBytes += SD_CHUNK; latBusyUs += us;
+    uint16_t sec = (uint16_t)(elapsed / 1000);
+    if (sec < LAT_SECONDS && us > secMaxUs[sec]) secMaxUs[sec] = us;
+    // A fresh file keeps cluster allocation in the measurement, as in a log.
+    if (written >= WRAP_BYTES && !reopenScratch()) fail("Cannot recreate scratch file");
+}
+
+static void stepFlush() {
+    if (timedWrite(SD_CHUNK) == UINT32_MAX) return;
+    uint32_t t0 = halMicros();
+    scratch->flush();
+    flushHist.add(halMicros() - t0);
+    if (++rounds >= SDBENCH_FLUSH_ROUNDS) phase = Phase::Report;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Report + recommendations
+// ─────────────────────────────────────────────────────────────
+static FileHandle* reportFile = nullptr;
+
+static void out(const char* s) {
+    Serial.print("[BENCH] "); Serial.println(s);
+    if (reportFile) reportFile->println(s);
+}
+
+static uint32_t nextPow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+static void report() {
+    hal.fs->close(scratch);
+    scratch = nullptr;
+    hal.fs->remove(SCRATCH);
+    hal.fs->remove(REPORT);
+    reportFile = hal.fs->open(REPORT, FileMode::Overwrite);
+
+    char b[96];
+    out("SD card benchmark");
+    out("block      KB/s   max write us");
+    uint32_t bestKBs = 0;
+    for (uint8_t i = 0; i < NUM_SIZES; i++) {
+        snprintf(b, sizeof(b), "%5u  %8lu  %13lu", BLOCK_SIZES[i],
+            (unsigned long)seqKBs[i], (unsigned long)seqMaxUs[i]);
+        out(b);
+        if (seqKBs[i] > bestKBs) bestKBs = seqKBs[i];
+    }
+
+    snprintf(b, sizeof(b), "latency: %lu writes of %u B, %lu KB/s sustained",
+        (unsigned long)writeHist.n, SD_CHUNK,
+        (unsigned long)(latBytes * 1000000 / max(latBusyUs, (uint64_t)1) / 1024));
+    out(b);
+    snprintf(b, sizeof(b), "  write us  p50 <%lu  p99 <%lu  p99.9 <%lu  max %lu",
+        (unsigned long)writeHist.percentile(50), (unsigned long)writeHist.percentile(99),
+        (unsigned long)writeHist.percentile(99.9f), (unsigned long)writeHist.maxUs);
+    out(b);
+
+    // Distribution of the per-second worst case (insertion sort, 60 entries).
+    uint32_t sorted[LAT_SECONDS];
+    memcpy(sorted, secMaxUs, sizeof(sorted));
+    for (uint16_t i = 1; i < LAT_SECONDS; i++)
+        for (uint16_t j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+            uint32_t t = sorted[j]; sorted[j] = sorted[j - 1]; sorted[j - 1] = t;
+        }
+    snprintf(b, sizeof(b), "  worst per second us  min %lu  median %lu  p90 %lu  max %lu",
+        (unsigned long)sorted[0], (unsigned long)sorted[LAT_SECONDS / 2],
+        (unsigned long)sorted[LAT_SECONDS * 9 / 10], (unsigned long)sorted[LAT_SECONDS - 1]);
+    out(b);
+    snprintf(b, sizeof(b), "flush us  mean %lu  p99 <%lu  max %lu",
+        (unsigned long)(flushHist.sum / max(flushHist.n, 1u)),
+        (unsigned long)flushHist.percentile(99), (unsigned long)flushHist.maxUs);
+    out(b);
+
+    // Staging ring: ride out twice the worst stall at the worst-case data
+    // rate (a full ROW_BUF_SIZE row every poll), plus one chunk in flight.
+    uint32_t rateBps = ROW_BUF_SIZE * 1000 / max(pollIntervalMs, (uint32_t)1);
+    uint32_t stallUs = max(writeHist.maxUs, flushHist.maxUs);
+    uint32_t ring    = nextPow2(max((uint32_t)((uint64_t)2 * stallUs * rateBps / 1000000) + SD_CHUNK,
+                                    (uint32_t)SD_CHUNK * 4));
+    // Chunk: smallest block within 10 % of the best throughput.
+    uint16_t chunk = BLOCK_SIZES[NUM_SIZES - 1];
+    for (uint8_t i = 0; i < NUM_SIZES; i++)
+        if (seqKBs[i] * 10 >= bestKBs * 9) { chunk = BLOCK_SIZES[i]; break; }
+    // Sync: keep flush overhead near 2 % of wall time, in 250 ms steps.
+    uint32_t syncMs = (flushHist.percentile(99) / 20 + 249) / 250 * 250;
+    syncMs = min(max(syncMs, (uint32_t)250), (uint32_t)10000);
+
+    snprintf(b, sizeof(b), "recommend SD_RING_SIZE >= %lu (now %lu)",
+        (unsigned long)ring, (unsigned long)SD_RING_SIZE);
+    out(b);
+    snprintf(b, sizeof(b), "recommend SD_CHUNK = %u (now %u)", chunk, SD_CHUNK);
+    out(b);
+    snprintf(b, sizeof(b), "sync max age set to %lu ms (was %lu)",
+        (unsigned long)syncMs, (unsigned long)syncIntervalMs);
+    out(b);
+    if ((uint64_t)latBytes * 1000000 / max(latBusyUs, (uint64_t)1) < (uint64_t)rateBps * 2)
+        out("WARNING: sustained write rate is under 2x the worst-case log rate");
+    syncIntervalMs = syncMs;
+
+    if (reportFile) {
+        hal.fs->close(reportFile);
+        reportFile = nullptr;
+        Serial.print("[BENCH] Report written to /"); Serial.println(REPORT);
+    }
+    phase = Phase::Idle;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Public
+// ─────────────────────────────────────────────────────────────
+BenchStart sdBenchStart() {
+    if (phase != Phase::Idle) return BenchStart::Busy;
+    for (size_t i = 0; i < sizeof(benchBuf); i++) benchBuf[i] = (uint8_t)('0' + i % 10);
+    memset(seqKBs, 0, sizeof(seqKBs));
+    memset(seqMaxUs, 0, sizeof(seqMaxUs));
+    memset(&writeHist, 0, sizeof(writeHist));
+    memset(&flushHist, 0, sizeof(flushHist));
+    memset(secMaxUs, 0, sizeof(secMaxUs));
+    latBytes = latBusyUs = 0;
+    sizeIdx = 0; busyUs = 0;
+    if (!reopenScratch()) return BenchStart::NoFile;
+    Serial.print("[BENCH] Sequential writes: "); Serial.print(SDBENCH_SEQ_BYTES >> 20);
+    Serial.println(" MB per block size...");
+    phase = Phase::Seq;
+    return BenchStart::Started;
+}
+
+bool sdBenchActive() { return phase != Phase::Idle; }
+
+void sdBenchTask() {
+    uint32_t t0 = halMicros();
+    while (halMicros() - t0 < SDBENCH_SLICE_US) {
+        switch (phase) {
+            case Phase::Idle:    return;
+            case Phase::Seq:     stepSeq();     break;
+            case Phase::Latency: stepLatency(); break;
+            case Phase::Flush:   stepFlush();   break;
+            case Phase::Report:  report();      return;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+// ============================================================
+//  sdbench.h — SD card self-characterisation ('b')
+// ============================================================
+//
+//  Benchmarks the inserted card through hal.fs — the same SD/SdFat
+//  path the logger writes through — in three passes:
+//
+//    seq      SDBENCH_SEQ_BYTES at each block size → KB/s, max write
+//    latency  SD_CHUNK writes for SDBENCH_LATENCY_MS → per-write
+//             histogram and per-second worst case
+//    flush    SDBENCH_FLUSH_ROUNDS × (SD_CHUNK write + flush)
+//
+//  Runs as the "bench" task in slices of SDBENCH_SLICE_US, holding
+//  the ECU state machine off while active. The report goes to Serial
+//  and /SDBENCH.TXT; the recommended sync interval is applied to
+//  syncIntervalMs, the recommended SD_RING_SIZE / SD_CHUNK are printed
+//  (both are build-time constants).
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+enum class BenchStart : uint8_t { Started, Busy, NoFile };
+
+BenchStart sdBenchStart();   // Busy if a run is in progress, NoFile if the scratch file cannot be created
+bool       sdBenchActive();
+void       sdBenchTask();   // "bench" task — one slice while active
@@ -0,0 +1,210 @@
+// ============================================================
+//  sparse.cpp — change-of-value binary rows
+// ============================================================
+#include "sparse.h"
+#include "hal.h"
+#include "ini.h"
+#include <math.h>
+
+static const char* const SPARSE_CONFIG = "SPARSE.CFG";
+static constexpr uint16_t SPARSE_MAX_COLS  = MAX_CHANNELS + 8;   // channels + health
+static constexpr uint8_t  SPARSE_MAX_WORDS = 32;                 // packed 'bits' words
+static constexpr uint16_t SPARSE_MAX_SLOTS = SPARSE_MAX_COLS + SPARSE_MAX_WORDS;
+static constexpr uint8_t  STORE_FLOAT      = 0xFF;
+static constexpr uint8_t  STORE_PACKED     = 0xFE;
+
+static uint16_t numCols     = 0;
+static uint8_t  colStore[SPARSE_MAX_COLS];      // decimals of a fixed column, STORE_FLOAT or STORE_PACKED
+static uint8_t  colShow[SPARSE_MAX_COLS];       // 0 = integer, 1 + d = d decimals (for the expander)
+static float    colBand[SPARSE_MAX_COLS];
+static int64_t  colBandFixed[SPARSE_MAX_COLS];  // colBand in the column's fixed units
+static uint8_t  colWord[SPARSE_MAX_COLS];       // STORE_PACKED: word and field
+static uint8_t  colLo[SPARSE_MAX_COLS], colWidth[SPARSE_MAX_COLS];
+
+// Words of packed flags; slot numCols + w in a record.
+struct PackedWord { uint16_t offset; TypeCode tc; };
+static PackedWord words[SPARSE_MAX_WORDS];
+static uint8_t    numWords  = 0;
+static uint32_t   wordValue[SPARSE_MAX_WORDS];
+
+static float    lastValue[SPARSE_MAX_SLOTS];    // as last written
+static int64_t  lastFixed[SPARSE_MAX_SLOTS];
+static bool     written     = false;            // any row stored yet
+static uint32_t lastMs      = 0;
+
+// The row being encoded, applied by sparseCommit().
+static uint16_t pendIdx[SPARSE_MAX_SLOTS];
+static float    pendVal[SPARSE_MAX_SLOTS];
+static int64_t  pendFixed[SPARSE_MAX_SLOTS];
+static uint16_t pendCount   = 0;
+static uint32_t pendMs      = 0;
+
+static void loadDeadbands(uint16_t channelCols) {
+    FileHandle* f = hal.fs->open(SPARSE_CONFIG, FileMode::Read);
+    if (!f) return;
+    char line[96];
+    while (readLine(f, line, sizeof(line))) {
+        char* sc = strchr(line, ';');
+        if (sc) *sc = '\0';
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        char* name = line;
+        while (*name == ' ' || *name == '\t') name++;
+        trimRight(name);
+        int16_t ch = findChannelByName(name);
+        if (ch < 0) { Serial.print("[SPRS] Channel not in INI: "); Serial.println(name); continue; }
+        float band = strtof(eq + 1, nullptr);
+        for (uint16_t c = 0; c < channelCols; c++) {
+            uint16_t idx = numDLChannels > 0 ? dlChannels[c].chanIdx : c;
+            if (idx == (uint16_t)ch) sparseColumn(c, band);
+        }
+    }
+    hal.fs->close(f);
+}
+
+static int8_t wordFor(const Channel& ch) {
+    for (uint8_t w = 0; w < numWords; w++)
+        if (words[w].offset == ch.offset && words[w].tc == ch.tc) return w;
+    if (numWords == SPARSE_MAX_WORDS) return -1;
+    words[numWords] = { ch.offset, ch.tc };
+    return numWords++;
+}
+
+void sparseBegin(uint16_t channelCols, uint16_t totalCols) {
+    numCols  = min(totalCols, SPARSE_MAX_COLS);
+    numWords = 0;
+    for (uint16_t c = 0; c < numCols; c++) {
+        if (c < channelCols) {
+            const Channel& ch = numDLChannels > 0 ? channels[dlChannels[c].chanIdx] : channels[c];
+            bool asFloat = numDLChannels > 0 ? dlChannels[c].isFloat : true;
+            colStore[c]  = isFixedKind(ch.dk) ? ch.fixDigits : STORE_FLOAT;
+            colShow[c]   = asFloat ? 1 + (numDLChannels > 0 ? dlChannels[c].digits : ch.digits) : 0;
+            int8_t w     = SPARSE_PACK_BITS && ch.dk == DK_BITS ? wordFor(ch) : -1;
+            if (w >= 0) {
+                colStore[c] = STORE_PACKED;
+                colWord[c]  = w;
+                colLo[c]    = ch.bitLo;
+                colWidth[c] = ch.bitWidth;
+            }
+        } else {
+            colStore[c]  = 0;
+            colShow[c]   = 0;
+        }
+        sparseColumn(c, 0);
+    }
+    written = false;
+    lastMs  = 0;
+    pendCount = 0;
+    loadDeadbands(channelCols);
+}
+
+void sparseColumn(uint16_t col, float deadband) {
+    if (col >= numCols) return;
+    colBand[col]      = deadband;
+    bool isFixed      = colStore[col] != STORE_FLOAT && colStore[col] != STORE_PACKED;
+    colBandFixed[col] = isFixed ? (int64_t)(deadband * powf(10, colStore[col]) + 0.5f) : 0;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Encoding
+// ─────────────────────────────────────────────────────────────
+static void putVarint(Print& out, uint64_t v) {
+    while (v >= 0x80) { out.write((uint8_t)(v | 0x80)); v >>= 7; }
+    out.write((uint8_t)v);
+}
+
+static uint8_t varintLen(uint32_t v) {
+    uint8_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+void sparseWriteHeader(Print& out) {
+    out.write((const uint8_t*)"TSB1", 4);
+    out.write((uint8_t)(numCols & 0xFF));
+    out.write((uint8_t)(numCols >> 8));
+    for (uint16_t c = 0; c < numCols; c++) {
+        if (colStore[c] == STORE_PACKED) {
+            out.write(SPARSE_STORE_BITS);
+            out.write(colWord[c]); out.write(colLo[c]); out.write(colWidth[c]);
+        } else {
+            out.write((uint8_t)(colStore[c] == STORE_FLOAT ? SPARSE_STORE_F32 : 1 + colStore[c]));
+        }
+        out.write(colShow[c]);
+    }
+    out.write(numWords);
+}
+
+static bool changed(uint16_t c, float v, int64_t x) {
+    if (!written) return true;
+    if (c >= numCols) return x != lastFixed[c];   // packed word
+    if (colStore[c] != STORE_FLOAT) {
+        int64_t d = x - lastFixed[c];
+        return (d < 0 ? -d : d) > colBandFixed[c];
+    }
+    if (!colShow[c]) return (int32_t)v != (int32_t)lastValue[c] && fabsf(v - lastValue[c]) > colBand[c];
+    return colBand[c] > 0 ? fabsf(v - lastValue[c]) > colBand[c] : v != lastValue[c];
+}
+
+void sparseEncode(Print& out, uint32_t ms, const float* values, const int64_t* fixed) {
+    pendCount = 0;
+    memset(wordValue, 0, numWords * sizeof(wordValue[0]));
+    for (uint16_t c = 0; c < numCols; c++) {
+        if (colStore[c] == STORE_PACKED) { wordValue[colWord[c]] |= (uint32_t)fixed[c] << colLo[c]; continue; }
+        bool    isFixed = colStore[c] != STORE_FLOAT;
+        float   v = isFixed ? 0 : values[c];
+        int64_t x = isFixed ? fixed[c] : 0;
+        if (!changed(c, v, x)) continue;
+        pendIdx[pendCount]   = c;
+        pendVal[pendCount]   = v;
+        pendFixed[pendCount] = x;
+        pendCount++;
+    }
+    for (uint8_t w = 0; w < numWords; w++) {
+        uint16_t slot = numCols + w;
+        if (!changed(slot, 0, wordValue[w])) continue;
+        pendIdx[pendCount]   = slot;
+        pendVal[pendCount]   = 0;
+        pendFixed[pendCount] = wordValue[w];
+        pendCount++;
+    }
+    pendMs = ms;
+
+    // Index list when it is shorter than the bitmap.
+    uint16_t bitmapBytes = (numCols + numWords + 7) / 8;
+    uint32_t listBytes   = varintLen(pendCount);
+    for (uint16_t i = 0; i < pendCount && listBytes <= bitmapBytes; i++)
+        listBytes += varintLen(i ? pendIdx[i] - pendIdx[i-1] : pendIdx[0]);
+
+    out.write(listBytes < bitmapBytes ? SPARSE_TAG_LIST : SPARSE_TAG_BITMAP);
+    putVarint(out, ms - lastMs);
+    if (listBytes < bitmapBytes) {
+        putVarint(out, pendCount);
+        for (uint16_t i = 0; i < pendCount; i++) putVarint(out, i ? pendIdx[i] - pendIdx[i-1] : pendIdx[0]);
+    } else {
+        uint16_t i = 0;
+        for (uint16_t b = 0; b < bitmapBytes; b++) {
+            uint8_t bits = 0;
+            while (i < pendCount && pendIdx[i] < (b + 1) * 8) bits |= 1 << (pendIdx[i++] - b * 8);
+            out.write(bits);
+        }
+    }
+    for (uint16_t i = 0; i < pendCount; i++) {
+        if (pendIdx[i] >= numCols || colStore[pendIdx[i]] != STORE_FLOAT) {
+            int64_t x = pendFixed[i];
+            putVarint(out, ((uint64_t)x << 1) ^ (uint64_t)(x >> 63));   // zigzag
+        } else {
+            out.write((const uint8_t*)&pendVal[i], 4);   // little-endian on both targets
+        }
+    }
+}
+
+void sparseCommit() {
+    for (uint16_t i = 0; i < pendCount; i++) {
+        lastValue[pendIdx[i]] = pendVal[i];
+        lastFixed[pendIdx[i]] = pendFixed[i];
+    }
+    lastMs  = pendMs;
+    written = true;
+}
@@ -0,0 +1,50 @@
+// ============================================================
+//  sparse.h — change-of-value binary rows (.tsb)
+// ============================================================
+//
+//  Most columns repeat from one row to the next. In sparse mode a row
+//  stores its time and only the columns that moved more than their
+//  deadband since the value last written; tools/expand turns the file
+//  back into a dense .msl. File layout (little-endian):
+//
+//    "TSB1"  u16 columns  then per column:
+//      u8 store      0 = f32, 1 + s = integer in units of 10^-s,
+//                    0xFF = bits of a packed word, followed by
+//                    u8 word, u8 lo, u8 width
+//      u8 show       0 = integer, 1 + d = d decimals
+//    u8 words        packed words, stored as hidden integer columns
+//                    numbered from `columns` on
+//    MSL text header (preamble, names, units)   terminated by a NUL byte
+//    records, each:
+//      u8 tag        0 = bitmap follows, 1 = index list follows
+//      varint        ms since the previous record (first: since log start)
+//      bitmap        ceil((columns + words) / 8) bytes, bit i = column i present
+//      or varint n,  then n varint index gaps (first index, then deltas)
+//      values        present columns in order: f32, or zigzag varint
+//
+//  Deadbands are per channel from /SPARSE.CFG (`channel = band`, INI
+//  [OutputChannels] names; default 0 = any change). The encoder
+//  compares with the last value written, not the previous row, so the
+//  expanded value never drifts more than the deadband. With
+//  SPARSE_PACK_BITS, INI 'bits' flags that share a word are stored as
+//  that word (masked to the logged flags) when any of them changes.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+static constexpr uint8_t SPARSE_TAG_BITMAP = 0;
+static constexpr uint8_t SPARSE_TAG_LIST   = 1;
+static constexpr uint8_t SPARSE_STORE_F32  = 0;
+static constexpr uint8_t SPARSE_STORE_BITS = 0xFF;
+
+// channelCols logged INI channels, followed by extra (health) columns,
+// which are plain integers.
+void sparseBegin(uint16_t channelCols, uint16_t totalCols);
+void sparseColumn(uint16_t col, float deadband);
+void sparseWriteHeader(Print& out);       // magic, column count and kinds
+// Encode one row into out: isFixedKind() channels (and extra columns)
+// from fixed, the others from values. Call sparseCommit() once it is stored,
+// so a dropped row never becomes the reference for the next one.
+void sparseEncode(Print& out, uint32_t ms, const float* values, const int64_t* fixed);
+void sparseCommit();
@@ -0,0 +1,212 @@
+// ============================================================
+//  tables.cpp — streaming 2D tables
+// ============================================================
+#include "tables.h"
+#include "hal.h"
+#include "ini.h"
+#include <float.h>
+
+static const char* const TABLES_CONFIG = "TABLES.CFG";
+
+struct Cell {
+    double   sum;
+    uint32_t count;
+    float    min, max;
+};
+
+struct Table {
+    char     name[16];
+    int16_t  x, y, value;                    // channel indices
+    float    xEdges[TABLE_MAX_BINS + 1];
+    float    yEdges[TABLE_MAX_BINS + 1];
+    uint8_t  nx, ny;                         // edge counts
+    uint32_t outside;                        // rows outside the edges
+};
+
+static Table    tables[TABLE_MAX];
+static uint8_t  numTables = 0;
+DMAMEM static Cell cells[TABLE_MAX][TABLE_MAX_BINS][TABLE_MAX_BINS];
+
+// ─────────────────────────────────────────────────────────────
+//  Config
+// ─────────────────────────────────────────────────────────────
+static char* trimLeft(char* s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return s;
+}
+
+static uint8_t parseEdges(const char* s, float* out) {
+    uint8_t n = 0;
+    while (*s && n < TABLE_MAX_BINS + 1) {
+        char* end;
+        float v = strtof(s, &end);
+        if (end == s) break;
+        out[n++] = v;
+        s = end;
+        while (*s == ' ' || *s == ',') s++;
+    }
+    return n;
+}
+
+static bool edgesValid(const float* e, uint8_t n) {
+    if (n < 2) return false;
+    for (uint8_t i = 1; i < n; i++) if (e[i] <= e[i-1]) return false;
+    return true;
+}
+
+// Keep the table being parsed only if it resolved completely.
+static void finishTable() {
+    if (numTables >= TABLE_MAX) return;
+    Table& t = tables[numTables];
+    if (!t.name[0]) return;
+    const char* why = nullptr;
+    if (t.x < 0 || t.y < 0 || t.value < 0)  why = "unknown channel";
+    else if (!edgesValid(t.xEdges, t.nx))   why = "xedges need 2+ ascending values";
+    else if (!edgesValid(t.yEdges, t.ny))   why = "yedges need 2+ ascending values";
+    if (why) {
+        Serial.print("[TBL] "); Serial.print(t.name); Serial.print(": "); Serial.println(why);
+        return;
+    }
+    numTables++;
+}
+
+static void loadConfig() {
+    FileHandle* f = hal.fs->open(TABLES_CONFIG, FileMode::Read);
+    if (!f) return;
+    char line[160];
+    while (readLine(f, line, sizeof(line))) {
+        char* sc = strchr(line, ';');
+        if (sc) *sc = '\0';
+        trimRight(line);
+        char* p = trimLeft(line);
+        if (!*p) continue;
+
+        if (*p == '[') {
+            finishTable();
+            if (numTables >= TABLE_MAX) {
+                Serial.print("[TBL] More than "); Serial.print(TABLE_MAX); Serial.println(" tables, rest ignored");
+                break;
+            }
+            Table& t = tables[numTables];
+            memset(&t, 0, sizeof(t));
+            t.x = t.y = t.value = -1;
+            char* close = strchr(p, ']');
+            if (close) *close = '\0';
+            strncpy(t.name, p + 1, sizeof(t.name) - 1);
+            continue;
+        }
+        if (numTables >= TABLE_MAX || !tables[numTables].name[0]) continue;
+
+        char* eq = strchr(p, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        trimRight(p);
+        char* val = trimLeft(eq + 1);
+        Table& t = tables[numTables];
+        if      (!strcmp(p, "x"))      t.x     = findChannelByName(val);
+        else if (!strcmp(p, "y"))      t.y     = findChannelByName(val);
+        else if (!strcmp(p, "value"))  t.value = findChannelByName(val);
+        else if (!strcmp(p, "xedges")) t.nx    = parseEdges(val, t.xEdges);
+        else if (!strcmp(p, "yedges")) t.ny    = parseEdges(val, t.yEdges);
+    }
+    finishTable();
+    hal.fs->close(f);
+}
+
+void tablesLoad() {
+    numTables = 0;
+    memset(tables, 0, sizeof(tables));
+    loadConfig();
+    for (uint8_t t = 0; t < numTables; t++) {
+        Serial.print("[TBL] "); Serial.print(tables[t].name); Serial.print(": ");
+        Serial.print(channels[tables[t].value].name); Serial.print(" by ");
+        Serial.print(channels[tables[t].x].name); Serial.print(" x ");
+        Serial.print(channels[tables[t].y].name); Serial.print(", ");
+        Serial.print(tables[t].nx - 1); Serial.print(" x "); Serial.print(tables[t].ny - 1);
+        Serial.println(" cells");
+    }
+}
+
+void tablesBegin() {
+    for (uint8_t t = 0; t < numTables; t++) {
+        tables[t].outside = 0;
+        for (uint8_t i = 0; i < TABLE_MAX_BINS; i++)
+            for (uint8_t j = 0; j < TABLE_MAX_BINS; j++)
+                cells[t][i][j] = { 0, 0, FLT_MAX, -FLT_MAX };
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Binning
+// ─────────────────────────────────────────────────────────────
+// Bin index for v, or -1 outside [e[0], e[n-1]]. At most
+// log2(TABLE_MAX_BINS) + 1 compares.
+static int8_t findBin(const float* e, uint8_t n, float v) {
+    if (!(v >= e[0]) || v > e[n-1]) return -1;   // also rejects NaN
+    uint8_t lo = 0, hi = n - 1;                   // e[lo] <= v, bin < hi
+    while (hi - lo > 1) {
+        uint8_t mid = (lo + hi) / 2;
+        if (v >= e[mid]) lo = mid; else hi = mid;
+    }
+    return (int8_t)lo;
+}
+
+void tablesRow(const uint8_t* blob) {
+    for (uint8_t t = 0; t < numTables; t++) {
+        Table& tb = tables[t];
+        int8_t bx = findBin(tb.xEdges, tb.nx, decodeChannel(blob, channels[tb.x]));
+        int8_t by = findBin(tb.yEdges, tb.ny, decodeChannel(blob, channels[tb.y]));
+        if (bx < 0 || by < 0) { tb.outside++; continue; }
+        float v = decodeChannel(blob, channels[tb.value]);
+        Cell& c = cells[t][bx][by];
+        c.sum += v;
+        c.count++;
+        if (v < c.min) c.min = v;
+        if (v > c.max) c.max = v;
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Output
+// ─────────────────────────────────────────────────────────────
+void tablesWrite(const char* logPath) {
+    if (numTables == 0) return;
+    char path[64];
+    strncpy(path, logPath, sizeof(path) - 12);
+    path[sizeof(path) - 12] = '\0';
+    char* dot = strrchr(path, '.');
+    if (!dot) return;
+    strcpy(dot, ".tables.csv");
+    FileHandle* f = hal.fs->open(path, FileMode::Overwrite);
+    if (!f) { Serial.print("[SD]  Cannot write "); Serial.println(path); return; }
+
+    f->println("table,x,y,value,x_lo,x_hi,y_lo,y_hi,count,mean,min,max");
+    for (uint8_t t = 0; t < numTables; t++) {
+        const Table& tb = tables[t];
+        uint32_t binned = 0;
+        for (uint8_t i = 0; i + 1 < tb.nx; i++) {
+            for (uint8_t j = 0; j + 1 < tb.ny; j++) {
+                const Cell& c = cells[t][i][j];
+                if (!c.count) continue;
+                binned += c.count;
+                f->print(tb.name);                      f->print(',');
+                f->print(channels[tb.x].name);          f->print(',');
+                f->print(channels[tb.y].name);          f->print(',');
+                f->print(channels[tb.value].name);      f->print(',');
+                f->print(tb.xEdges[i], 3);              f->print(',');
+                f->print(tb.xEdges[i+1], 3);            f->print(',');
+                f->print(tb.yEdges[j], 3);              f->print(',');
+                f->print(tb.yEdges[j+1], 3);            f->print(',');
+                f->print(c.count);                      f->print(',');
+                f->print(c.sum / c.count, 3);           f->print(',');
+                f->print(c.min, 3);                     f->print(',');
+                f->println(c.max, 3);
+            }
+        }
+        Serial.print("[TBL] "); Serial.print(tb.name); Serial.print(": ");
+        Serial.print(binned); Serial.print(" rows binned, ");
+        Serial.print(tb.outside); Serial.println(" outside");
+    }
+    hal.fs->close(f);
+    Serial.print("[SD]  Tables: "); Serial.println(path);
+}
@@ -0,0 +1,30 @@
+// ============================================================
+//  tables.h — streaming 2D tables (e.g. AFR by RPM × MAP)
+// ============================================================
+//
+//  Bins one channel's value over two axis channels while logging, so
+//  a cell-weighted tuning map is ready when the log closes instead of
+//  after a pass over the .msl. Tables come from /TABLES.CFG, read
+//  once after the INI is parsed, one section each; channels are INI
+//  [OutputChannels] names:
+//
+//    [AFR]
+//    x      = RPMValue
+//    y      = MAPValue
+//    value  = AFRValue
+//    xedges = 500, 1000, 1500, 2000, 3000, 4000, 5000, 6000
+//    yedges = 20, 40, 60, 80, 100, 150, 200
+//
+//  N edges make N-1 bins, lower edge inclusive; rows outside the
+//  edges are counted but not binned. Each cell keeps count, sum, min
+//  and max in a fixed grid (TABLE_MAX × TABLE_MAX_BINS²). Non-empty
+//  cells are written to <log>.tables.csv on close.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+void tablesLoad();                          // load TABLES.CFG against the parsed INI
+void tablesBegin();                         // reset cells (log start)
+void tablesRow(const uint8_t* blob);        // fold one logged 'O' blob in
+void tablesWrite(const char* logPath);      // write <log>.tables.csv (log close)
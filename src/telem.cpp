@@ -0,0 +1,128 @@
+// ============================================================
+//  telem.cpp — live binary telemetry frames
+// ============================================================
+#include "telem.h"
+#include "crc32.h"
+#include "hal.h"
+#include "ini.h"
+
+static constexpr uint8_t  TELEM_VERSION = 1;
+static constexpr uint16_t FRAME_MAX     = (MAX_CHANNELS * 4 > OCH_BUF_SIZE ? MAX_CHANNELS * 4 : OCH_BUF_SIZE) + 16;
+
+bool telemetryOn = TELEMETRY;
+
+static uint8_t  frame[FRAME_MAX];
+static uint16_t frameLen   = 0;
+static char     sig[64]    = {};
+static int32_t  descNext   = -1;   // next descriptor frame: -1 = header, then columns; numCols = done
+static bool     described  = false;
+static uint16_t seq        = 0;
+static uint32_t sent = 0, dropped = 0;
+
+static uint16_t columns() { return numDLChannels > 0 ? numDLChannels : numChannels; }
+static const Channel& column(uint16_t c) { return numDLChannels > 0 ? channels[dlChannels[c].chanIdx] : channels[c]; }
+
+// ─────────────────────────────────────────────────────────────
+//  Framing
+// ─────────────────────────────────────────────────────────────
+static void put(const void* p, uint16_t n) {
+    if (frameLen + n > FRAME_MAX - 4) return;
+    memcpy(frame + frameLen, p, n);
+    frameLen += n;
+}
+static void putU8(uint8_t v)   { put(&v, 1); }
+static void putU16(uint16_t v) { uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) }; put(b, 2); }
+static void putU32(uint32_t v) { uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) }; put(b, 4); }
+static void putText(const char* s) { put(s, (uint16_t)strlen(s) + 1); }
+
+static void beginFrame(char type) {
+    frameLen = 0;
+    putU8(TELEM_SYNC);
+    putU8((uint8_t)type);
+    putU16(0);
+}
+
+// Seal and send the frame if it fits in the link's free space.
+static bool endFrame() {
+    uint16_t len = frameLen - 4;
+    frame[2] = (uint8_t)len;
+    frame[3] = (uint8_t)(len >> 8);
+    uint32_t c = crc32(frame + 1, frameLen - 1);
+    frameLen += 4;
+    for (uint8_t k = 0; k < 4; k++) frame[frameLen - 4 + k] = (uint8_t)(c >> (8 * k));
+    if (hal.telemetry->availableForWrite() < (int)frameLen) return false;
+    return hal.telemetry->write(frame, frameLen) == frameLen;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Stream
+// ─────────────────────────────────────────────────────────────
+void telemBegin(const char* signature) {
+    strncpy(sig, signature, sizeof(sig) - 1);
+    sig[sizeof(sig) - 1] = '\0';
+    descNext  = -1;
+    described = true;
+}
+
+void telemEnd() {
+    sig[0]    = '\0';
+    descNext  = -1;
+    described = false;
+}
+
+void telemStart(bool on) {
+    telemetryOn = on;
+    descNext    = -1;
+    Serial.println(on ? "[TLM] Streaming." : "[TLM] Stopped.");
+}
+
+void telemTask() {
+    if (!telemetryOn || !hal.telemetry || !described) return;
+    uint16_t cols = TELEMETRY_RAW ? 0 : columns();
+    while (descNext < (int32_t)cols) {
+        if (descNext < 0) {
+            beginFrame('H');
+            putU8(TELEM_VERSION);
+            putU8(TELEMETRY_RAW ? 1 : 0);
+            putU16(columns());
+            putU16(ochBlockSize);
+            putText(sig);
+        } else {
+            const Channel& ch = column(descNext);
+            bool    named  = numDLChannels > 0;
+            uint8_t digits = named ? (dlChannels[descNext].isFloat ? dlChannels[descNext].digits : 0) : ch.digits;
+            beginFrame('C');
+            putU16((uint16_t)descNext);
+            putU8(digits);
+            putText(named ? dlChannels[descNext].label : ch.name);
+            putText(ch.unit);
+        }
+        if (!endFrame()) return;   // retried next pass
+        descNext++;
+    }
+}
+
+void telemSample(uint32_t ms, const uint8_t* blob) {
+    if (!telemetryOn || !hal.telemetry || !described) return;
+    seq++;
+    if (descNext < (int32_t)(TELEMETRY_RAW ? 0 : columns())) { dropped++; return; }
+    beginFrame('R');
+    putU32(ms);
+    putU16(seq);
+    if (TELEMETRY_RAW) {
+        put(blob, ochBlockSize);
+    } else {
+        for (uint16_t c = 0; c < columns(); c++) {
+            float v = decodeChannel(blob, column(c));
+            put(&v, 4);   // little-endian on both targets
+        }
+    }
+    if (endFrame()) sent++;
+    else            dropped++;
+}
+
+void telemPrintStats() {
+    if (!telemetryOn) return;
+    Serial.print("[TLM] Records sent "); Serial.print(sent);
+    Serial.print(", dropped "); Serial.println(dropped);
+}
@@ -0,0 +1,40 @@
+// ============================================================
+//  telem.h — live binary telemetry over hal.telemetry
+// ============================================================
+//
+//  Every completed poll can also go out to a host (a laptop dashboard,
+//  a DAQ PC) as one CRC-framed record, next to the SD log and without
+//  touching the ECU link. On the Teensy the stream shares the device
+//  Serial with the console text; the sync byte and CRC let a reader
+//  skip the text between frames. Frames (little-endian):
+//
+//    u8 0xA5  u8 type  u16 len  payload[len]  u32 crc32(type, len, payload)
+//
+//    'H'  header, sent first:  u8 version (1), u8 mode (0 = decoded,
+//         1 = raw), u16 columns, u16 ochBlockSize, ECU signature text
+//    'C'  one per column (decoded mode): u16 index, u8 decimals,
+//         name, NUL, unit, NUL
+//    'R'  record: u32 ms, u16 seq, then columns x f32 (decoded) or
+//         the ochBlockSize-byte blob (raw; decode with the INI named
+//         by the signature)
+//
+//  The header and column frames go out once per stream start, as the
+//  link has room; records wait until they are all out. A record that
+//  does not fit in the link's free space is dropped and counted, never
+//  queued, so a slow or absent host never delays the next poll. seq
+//  counts dropped records too, so the host sees the gaps.
+// ============================================================
+#pragma once
+
+#include "platform.h"
+
+static constexpr uint8_t TELEM_SYNC = 0xA5;
+
+extern bool telemetryOn;       // stream records; TELEMETRY unless overridden
+
+void telemBegin(const char* signature);   // after the INI is parsed: restart with a new descriptor
+void telemEnd();                          // ECU gone: nothing to describe until the next telemBegin()
+void telemStart(bool on);                 // 'l' / 'q': start (descriptor re-sent) or stop the stream
+void telemSample(uint32_t ms, const uint8_t* blob);   // one completed poll
+void telemTask();                         // descriptor frames as the link has room
+void telemPrintStats();
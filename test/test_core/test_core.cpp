@@ -0,0 +1,480 @@
+// ============================================================
+//  test_core.cpp — the logger core on the host HAL (pio test -e test)
+// ============================================================
+//
+//  RAM storage and an in-process ECU behind hal.h, as in tools/bench:
+//  MemStorage round trips, the SD staging ring, INI preprocessor rules,
+//  expression channels, big-endian decoding, the scheduler's yield and
+//  one full session from handshake to a closed .msl, held back first by
+//  an MTP upload, a sparse .tsb of the same data expanded back, and the
+//  fixed-point decode and format of scaled integer channels.
+// ============================================================
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "buffers.h"
+#include "crc32.h"
+#include "ini.h"
+#include "logger.h"
+#include "scheduler.h"
+#include "native/hal_posix.h"
+#include "../../tools/expand/expand.h"
+
+static PosixClock testClock;
+static PosixRtc   testRtc;
+static MemEcuPort port;
+static MemStorage storage;
+
+Hal hal = { &testClock, &testRtc, &port, &storage, nullptr, nullptr, nullptr };
+
+void setUp() {}
+void tearDown() {}
+
+static std::string text(const char* path) {
+    std::vector<uint8_t>* v = storage.get(path);
+    return v ? std::string(v->begin(), v->end()) : std::string();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Storage and buffers
+// ─────────────────────────────────────────────────────────────
+static void test_mem_storage_round_trip() {
+    FileHandle* f = storage.open("A.TXT", FileMode::Overwrite);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(5, f->write((const uint8_t*)"hello", 5));
+    storage.close(f);
+
+    f = storage.open("A.TXT", FileMode::Append);
+    f->write((const uint8_t*)" card", 5);
+    TEST_ASSERT_EQUAL(10, (int)f->size());
+    storage.close(f);
+    TEST_ASSERT_EQUAL_STRING("hello card", text("A.TXT").c_str());
+
+    char buf[8] = {};
+    f = storage.open("A.TXT", FileMode::Read);
+    TEST_ASSERT_TRUE(f->seek(6));
+    TEST_ASSERT_EQUAL(4, f->read(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("card", buf);
+    storage.close(f);
+
+    TEST_ASSERT_NULL(storage.open("MISSING.TXT", FileMode::Read));
+    TEST_ASSERT_TRUE(storage.mkdir("Feb 21 2026"));
+    TEST_ASSERT_TRUE(storage.exists("Feb 21 2026"));
+    TEST_ASSERT_TRUE(storage.remove("A.TXT"));
+    TEST_ASSERT_FALSE(storage.exists("A.TXT"));
+}
+
+static void test_byte_ring_wraps() {
+    static uint8_t mem[16];
+    ByteRing r = { mem, sizeof(mem) };
+    TEST_ASSERT_TRUE(r.push("0123456789", 10));
+    r.pop(8);
+    TEST_ASSERT_TRUE(r.push("abcdefghij", 10));   // wraps
+    TEST_ASSERT_FALSE(r.push("xyzxyz", 6));       // all or nothing
+    TEST_ASSERT_EQUAL(12, (int)r.used());
+
+    std::string out;
+    const uint8_t* p;
+    while (uint32_t n = r.peek(p)) { out.append((const char*)p, n); r.pop(n); }
+    TEST_ASSERT_EQUAL_STRING("89abcdefghij", out.c_str());
+}
+
+// ─────────────────────────────────────────────────────────────
+//  INI
+// ─────────────────────────────────────────────────────────────
+static Step parseIni(const char* path) {
+    Step st = Step::Failed;
+    if (beginINI(path)) while ((st = stepINI()) == Step::Pending) {}
+    return st;
+}
+
+static void test_ini_rejects_if_nesting_overflow() {
+    std::string ini = "[TunerStudio]\n   ochBlockSize = 8\n[OutputChannels]\n";
+    for (int d = 0; d < 32; d++) ini += "#if X\n";
+    for (int d = 0; d < 32; d++) ini += "#endif\n";
+    ini += "RPMValue = scalar, U16, 0, \"RPM\", 1, 0\n";
+    storage.put("DEEP.INI", ini);
+    Serial.muted = true;
+    Step st = parseIni("DEEP.INI");
+    Serial.muted = false;
+    TEST_ASSERT_TRUE(st == Step::Failed);
+}
+
+// { expression } channels: C precedence and associativity, names only
+// of earlier channels, the stack / cost / 159-character limits, and
+// evaluation against a blob.
+static void test_ini_expressions() {
+    std::string ones = "1";
+    for (int k = 1; k < 64; k++) ones += "+1";              // 127 ops in 127 characters
+    std::string deep = "1";
+    for (int k = 1; k < 17; k++) deep = "1 + (" + deep + ")";   // 17 values on the stack
+    std::string ini =
+        "[TunerStudio]\n"
+        "   ochBlockSize = 8\n"
+        "[OutputChannels]\n"
+        "rpm    = scalar, U16, 0, \"RPM\", 1, 0\n"
+        "tps    = scalar, U08, 2, \"%\", 0.5, 0\n"
+        "prec   = { 2 + 3 * 4 - 1 }\n"
+        "left   = { 100 - 10 - 5 }\n"
+        "div    = { 64 / 4 / 2 }\n"
+        "paren  = { (2 + 3) * 4 }\n"
+        "logic  = { 1 + 2 == 3 && 4 < 5 }\n"
+        "shift  = { 1 << 2 + 1 }\n"
+        "tern   = { 0 ? 1 : 0 ? 2 : 3 }\n"
+        "live   = { rpm > 2000 ? tps * 2 : -1 }\n"
+        "fwd    = { later + 1 }\n"
+        "later  = scalar, U08, 3, \"\", 1, 0\n"
+        "deep   = { " + deep + " }\n"
+        "costly = {" + ones + "+1}\n"
+        "cheap  = {" + ones + "}\n"
+        "nested = { cheap + 1 }\n"
+        "len159 = {1" + std::string(158, ' ') + "}\n"
+        "len160 = {1" + std::string(159, ' ') + "}\n";
+    storage.put("EXPR.INI", ini);
+    Serial.muted = true;
+    Step st = parseIni("EXPR.INI");
+    Serial.muted = false;
+    TEST_ASSERT_TRUE(st == Step::Done);
+
+    TEST_ASSERT_TRUE(findChannelByName("fwd") < 0);      // later channel
+    TEST_ASSERT_TRUE(findChannelByName("deep") < 0);     // stack limit
+    TEST_ASSERT_TRUE(findChannelByName("costly") < 0);   // 129 ops
+    TEST_ASSERT_TRUE(findChannelByName("nested") < 0);   // cheap's 127 count too
+    TEST_ASSERT_TRUE(findChannelByName("len160") < 0);
+    TEST_ASSERT_TRUE(findChannelByName("later") >= 0);
+
+    const uint8_t blob[8] = { 0xB8, 0x0B, 90, 7 };       // rpm 3000, tps 45 %
+    struct { const char* name; float v; } want[] = {
+        { "prec", 13 }, { "left", 85 }, { "div", 8 }, { "paren", 20 }, { "logic", 1 },
+        { "shift", 8 }, { "tern", 3 }, { "live", 90 }, { "cheap", 64 }, { "len159", 1 },
+    };
+    for (auto& w : want) {
+        int16_t i = findChannelByName(w.name);
+        TEST_ASSERT_TRUE(i >= 0);
+        TEST_ASSERT_EQUAL_FLOAT(w.v, decodeChannel(blob, channels[i]));
+    }
+}
+
+// Directives are whole words: "#ifdef" opens no block, "#setx" sets nothing.
+static void test_ini_directive_keywords() {
+    storage.put("PP.INI",
+        "[TunerStudio]\n"
+        "   ochBlockSize = 8\n"
+        "[OutputChannels]\n"
+        "#set FOO\n"
+        "#setx\n"
+        "#ifdef FOO\n"
+        "RPMValue = scalar, U16, 0, \"RPM\", 1, 0\n"
+        "#if x\n"
+        "wrong    = scalar, U08, 2, \"\", 1, 0\n"
+        "#else\n"
+        "coolant  = scalar, S16, 2, \"C\", 0.01, 0\n"
+        "#endif\n"
+        "#if FOO\n"
+        "seconds  = scalar, U32, 4, \"s\", 1, 0\n"
+        "#endif\n");
+    Serial.muted = true;
+    Step st = parseIni("PP.INI");
+    Serial.muted = false;
+    TEST_ASSERT_TRUE(st == Step::Done);
+    TEST_ASSERT_EQUAL(3, numChannels);
+    TEST_ASSERT_EQUAL_STRING("RPMValue", channels[0].name);
+    TEST_ASSERT_EQUAL_STRING("coolant",  channels[1].name);
+    TEST_ASSERT_EQUAL_STRING("seconds",  channels[2].name);
+}
+
+static void test_ini_big_endian_decode() {
+    storage.put("BIG.INI",
+        "[TunerStudio]\n"
+        "   ochBlockSize = 8\n"
+        "   endianness = big\n"
+        "[OutputChannels]\n"
+        "RPMValue = scalar, U16, 0, \"RPM\", 1, 0\n"
+        "coolant  = scalar, S16, 2, \"C\", 0.01, 0\n"
+        "seconds  = scalar, U32, 4, \"s\", 1, 0\n");
+    Serial.muted = true;
+    Step st = parseIni("BIG.INI");
+    Serial.muted = false;
+    TEST_ASSERT_TRUE(st == Step::Done);
+    TEST_ASSERT_EQUAL(3, numChannels);
+
+    const uint8_t blob[8] = { 0x0B, 0xB8, 0xDD, 0xEB, 0x00, 0x01, 0x02, 0x03 };
+    TEST_ASSERT_EQUAL_FLOAT(3000.0f, decodeChannel(blob, channels[0]));
+    TEST_ASSERT_EQUAL_FLOAT(-87.25f, decodeChannel(blob, channels[1]));
+    TEST_ASSERT_EQUAL(0x00010203, (int)decodeRaw(blob, channels[2]));
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Scheduler
+// ─────────────────────────────────────────────────────────────
+static int runsA = 0, runsB = 0, yieldsOk = 0;
+
+static void taskA() {
+    runsA++;
+    if (schedYield()) yieldsOk++;
+}
+static void taskB() {
+    runsB++;
+    if (schedYield()) yieldsOk++;
+}
+
+// A yields: B runs nested and its own yield is refused. Then B's turn in
+// the pass: its yield runs A, whose nested yield is refused.
+static void test_sched_yield_skips_running_tasks() {
+    static Task tasks[] = {
+        { "a", taskA, 0, 1000, false },
+        { "b", taskB, 0, 1000, false },
+    };
+    schedBegin(tasks, 2);
+    schedLoop();
+    TEST_ASSERT_EQUAL(2, runsA);
+    TEST_ASSERT_EQUAL(2, runsB);
+    TEST_ASSERT_EQUAL(2, yieldsOk);
+    TEST_ASSERT_FALSE(tasks[0].running || tasks[1].running);
+    schedBegin(nullptr, 0);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  One logging session on RAM storage
+// ─────────────────────────────────────────────────────────────
+static const char TEST_INI[] =
+    "[MegaTune]\n"
+    "   signature = \"rusEFI test\"\n"
+    "[TunerStudio]\n"
+    "   ochBlockSize = 8\n"
+    "[OutputChannels]\n"
+    "RPMValue = scalar, U16, 0, \"RPM\", 1, 0\n"
+    "coolant  = scalar, S16, 2, \"C\", 0.01, 0\n"
+    "seconds  = scalar, U32, 4, \"s\", 1, 0\n";
+
+static uint32_t polls = 0;
+
+// RPM 3000, coolant 87.25 C stepping down 0.25 C over four polls,
+// seconds = poll number; little-endian.
+static void sessionBlob(uint8_t* b, uint32_t n) {
+    int16_t coolant = (int16_t)(8725 - (n % 4) * 25);
+    b[0] = 0xB8; b[1] = 0x0B;
+    b[2] = (uint8_t)coolant; b[3] = (uint8_t)(coolant >> 8);
+    for (int k = 0; k < 4; k++) b[4 + k] = (uint8_t)(n >> (8 * k));
+}
+
+static void (*ecuBlob)(uint8_t* b, uint32_t n) = sessionBlob;   // the 8 bytes each poll returns
+
+static void onEcuWrite(MemEcuPort& p) {
+    size_t i = 0;
+    while (i < p.tx.size()) {
+        uint8_t c = p.tx[i];
+        if (c == 'S') {
+            static const char sig[] = "rusEFI test\n";
+            p.rx.insert(p.rx.end(), sig, sig + sizeof(sig) - 1);
+            i++;
+        } else if (c == 'F') {
+            static const char ok[] = "001\n";
+            p.rx.insert(p.rx.end(), ok, ok + sizeof(ok) - 1);
+            i++;
+        } else if (c == 0x00) {
+            if (p.tx.size() - i < 11) break;
+            polls++;
+            uint8_t r[2 + 1 + 8 + 4] = { 0, 9, 0x00 };
+            ecuBlob(r + 3, polls);
+            uint32_t crc = crc32(r + 2, 9);
+            for (int k = 0; k < 4; k++) r[11 + k] = (uint8_t)(crc >> (24 - 8 * k));
+            p.rx.insert(p.rx.end(), r, r + sizeof(r));
+            i += 11;
+        } else {
+            i++;
+        }
+    }
+    p.tx.erase(p.tx.begin(), p.tx.begin() + i);
+}
+
+static void test_session_writes_msl_to_ram() {
+    storage.put("DEFAULT.INI", TEST_INI);
+    port.onWrite   = onEcuWrite;
+    pollIntervalMs = 2;
+    Serial.muted   = true;
+
+    // An MTP upload open when polling would start holds the log back.
+    loggerHostWrite(true);
+    loggerBegin(true);
+    uint32_t t0 = halMillis();
+    while (halMillis() - t0 < 1000) {
+        loggerStep();
+        loggerDrainTask();
+    }
+    TEST_ASSERT_TRUE(loggerState() == State::SettleMode);
+    TEST_ASSERT_NULL(loggerActiveLog());
+    loggerHostWrite(false);
+
+    t0 = halMillis();
+    while (polls < 50 && halMillis() - t0 < 5000) {
+        loggerStep();
+        loggerDrainTask();
+    }
+    TEST_ASSERT_TRUE(loggerState() == State::Logging);
+    TEST_ASSERT_NOT_NULL(loggerActiveLog());
+    std::string path = loggerActiveLog();
+    loggerCommand('s');
+    Serial.muted = false;
+
+    TEST_ASSERT_NULL(loggerActiveLog());
+    TEST_ASSERT_EQUAL(1, (int)loggerLogsClosed());
+    std::string msl = text(path.c_str());
+    TEST_ASSERT_TRUE(msl.find("Time\tRPMValue\tcoolant\tseconds") != std::string::npos);
+    TEST_ASSERT_TRUE(msl.find("\t3000\t87.25\t") != std::string::npos);
+    TEST_ASSERT_TRUE(text("CATALOG.CSV").find(path) != std::string::npos);
+}
+
+// Run a session until n polls were answered, then stop it ('s');
+// the closed log's path.
+static std::string logPolls(uint32_t n) {
+    port.rx.clear();
+    port.tx.clear();
+    polls = 0;
+    Serial.muted = true;
+    loggerBegin(true);
+    uint32_t t0 = halMillis();
+    while (polls < n && halMillis() - t0 < 5000) {
+        loggerStep();
+        loggerDrainTask();
+    }
+    std::string path = loggerActiveLog() ? loggerActiveLog() : "";
+    loggerCommand('s');
+    Serial.muted = false;
+    return path;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out(1);
+    for (char c : s) {
+        if (c == sep)       out.emplace_back();
+        else if (c != '\r') out.back() += c;
+    }
+    return out;
+}
+
+// The same ECU data logged sparse and expanded by tools/expand gives the
+// dense log's header and INI columns. Time and the health columns
+// depend on when each session ran, so they are not compared.
+static void test_sparse_log_expands_to_msl() {
+    std::string mslPath = logPolls(60);
+    sparseLog = true;
+    std::string tsbPath = logPolls(60);
+    sparseLog = false;
+    TEST_ASSERT_TRUE(tsbPath.size() > 4 && tsbPath.substr(tsbPath.size() - 4) == ".tsb");
+
+    char in[]  = "/tmp/test_core_tsbXXXXXX";
+    char out[] = "/tmp/test_core_mslXXXXXX";
+    int fdIn = mkstemp(in), fdOut = mkstemp(out);
+    TEST_ASSERT_TRUE(fdIn >= 0 && fdOut >= 0);
+    std::vector<uint8_t>* tsb = storage.get(tsbPath.c_str());
+    TEST_ASSERT_NOT_NULL(tsb);
+    TEST_ASSERT_EQUAL((int)tsb->size(), (int)write(fdIn, tsb->data(), tsb->size()));
+    close(fdIn);
+    close(fdOut);
+    int rc = expandLog(in, out);
+    std::string expanded;
+    if (FILE* f = fopen(out, "rb")) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) expanded.append(buf, n);
+        fclose(f);
+    }
+    unlink(in);
+    unlink(out);
+    TEST_ASSERT_EQUAL(0, rc);
+
+    std::vector<std::string> dense = split(text(mslPath.c_str()), '\n');
+    std::vector<std::string> exp   = split(expanded, '\n');
+    size_t head = 0;
+    while (head < dense.size() && dense[head].compare(0, 5, "Time\t") != 0) head++;
+    head += 2;                                    // names and units
+    TEST_ASSERT_TRUE(head < dense.size() && head < exp.size());
+    for (size_t k = 0; k < head; k++) TEST_ASSERT_EQUAL_STRING(dense[k].c_str(), exp[k].c_str());
+
+    size_t rows = 0;
+    for (size_t k = head; k < dense.size() && k < exp.size(); k++) {
+        std::vector<std::string> a = split(dense[k], '\t'), b = split(exp[k], '\t');
+        if (a.size() < 4 || b.size() < 4) break;
+        TEST_ASSERT_EQUAL(a.size(), b.size());
+        for (size_t c = 1; c <= 3; c++) TEST_ASSERT_EQUAL_STRING(a[c].c_str(), b[c].c_str());
+        rows++;
+    }
+    TEST_ASSERT_TRUE(rows >= 50);
+}
+
+// Integer channels with a decimal scale are decoded and printed without
+// float: negatives, a carry out of the last shown digit, the 6-digit
+// limit, and scales that must fall back to float.
+static const char FIXED_INI[] =
+    "[MegaTune]\n"
+    "   signature = \"rusEFI test\"\n"
+    "[TunerStudio]\n"
+    "   ochBlockSize = 8\n"
+    "[OutputChannels]\n"
+    "neg     = scalar, S16, 0, \"\", 0.1, 0\n"
+    "negCarry= scalar, S16, 0, \"\", 0.001, 0, 0, 0, 2\n"
+    "carry   = scalar, U16, 2, \"\", 0.001, 0, 0, 0, 2\n"
+    "offset  = scalar, U16, 2, \"\", 0.5, -40.25\n"
+    "third   = scalar, U16, 2, \"\", 0.1, 0.3333333\n"
+    "micro   = scalar, U32, 4, \"\", 0.000001, 0, 0, 0, 6\n"
+    "tenth   = scalar, U32, 4, \"\", 0.0000001, 0\n";
+
+// -9995, 9995, 1234567
+static void fixedBlob(uint8_t* b, uint32_t) {
+    static const uint8_t v[8] = { 0xF5, 0xD8, 0x0B, 0x27, 0x87, 0xD6, 0x12, 0x00 };
+    memcpy(b, v, 8);
+}
+
+static void test_fixed_point_decode_and_format() {
+    storage.put("DEFAULT.INI", FIXED_INI);
+    ecuBlob = fixedBlob;
+    std::string path = logPolls(5);
+    ecuBlob = sessionBlob;
+    storage.put("DEFAULT.INI", TEST_INI);
+
+    struct { const char* name; DecodeKind dk; uint8_t digits; int64_t fixed; const char* text; } want[] = {
+        { "neg",      DK_FIXED, 1, -9995,    "-999.5"   },
+        { "negCarry", DK_FIXED, 3, -9995,    "-10.00"   },
+        { "carry",    DK_FIXED, 3, 9995,     "10.00"    },
+        { "offset",   DK_FIXED, 2, 495725,   "4957.25"  },
+        { "third",    DK_FLOAT, 0, 0,        nullptr    },
+        { "micro",    DK_FIXED, 6, 1234567,  "1.234567" },
+        { "tenth",    DK_FLOAT, 0, 0,        nullptr    },
+    };
+    uint8_t blob[8];
+    fixedBlob(blob, 0);
+    std::vector<std::string> lines = split(text(path.c_str()), '\n');
+    size_t row = 0;
+    while (row < lines.size() && lines[row].compare(0, 5, "Time\t") != 0) row++;
+    row += 2;
+    TEST_ASSERT_TRUE(row < lines.size());
+    std::vector<std::string> cols = split(lines[row], '\t');
+
+    for (size_t k = 0; k < sizeof(want) / sizeof(want[0]); k++) {
+        const Channel& ch = channels[findChannelByName(want[k].name)];
+        TEST_ASSERT_TRUE(ch.dk == want[k].dk);
+        if (want[k].dk != DK_FIXED) continue;
+        TEST_ASSERT_EQUAL(want[k].digits, ch.fixDigits);
+        TEST_ASSERT_EQUAL(want[k].fixed, decodeFixed(blob, ch));
+        TEST_ASSERT_EQUAL_STRING(want[k].text, cols[1 + k].c_str());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_mem_storage_round_trip);
+    RUN_TEST(test_byte_ring_wraps);
+    RUN_TEST(test_ini_rejects_if_nesting_overflow);
+    RUN_TEST(test_ini_directive_keywords);
+    RUN_TEST(test_ini_expressions);
+    RUN_TEST(test_ini_big_endian_decode);
+    RUN_TEST(test_sched_yield_skips_running_tasks);
+    RUN_TEST(test_session_writes_msl_to_ram);
+    RUN_TEST(test_sparse_log_expands_to_msl);
+    RUN_TEST(test_fixed_point_decode_and_format);
+    return UNITY_END();
+}
@@ -0,0 +1,382 @@
+// ============================================================
+//  bench.cpp — end-to-end pipeline benchmark for the host build
+// ============================================================
+//
+//  Replays a fixed corpus of OCH blobs through the real logger core:
+//  INI parse → CRC-framed 'O' reply → decode → format → SD ring →
+//  RAM-backed log file. The ECU is an in-process MemEcuPort whose
+//  replies are pre-framed, so the harness itself costs next to nothing.
+//
+//  Suites (tools/bench/ini + tools/bench/corpus):
+//    small_datalog   48 channels, 16-entry [Datalog]
+//    full_300        300 mixed-type channels, all logged
+//    wide_float      300 F32 channels, all logged
+//
+//  Metrics per suite:
+//    parse_us        best-of-N time to parse the INI (beginINI/stepINI)
+//    rows_per_s      rows written per second (best segment)
+//    bytes_per_s     MSL bytes written per second
+//    cycles_per_row  TSC cycles per row (ns on non-x86 hosts)
+//    allocs          operator new calls while logging (should be 0)
+//
+//    bench --save baseline.txt            record a baseline
+//    bench --check baseline.txt [--tolerance 10]
+//                                         exit 1 if any metric regressed
+//                                         by more than the tolerance (%)
+//
+//  Timings are only comparable on the same machine — keep baselines
+//  local, next to the build.
+// ============================================================
+#include "../../src/crc32.h"
+#include "../../src/ini.h"
+#include "../../src/logger.h"
+#include "../../src/native/hal_posix.h"
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ─── Allocation counter ─────────────────────────────────────
+static bool     countAllocs = false;
+static uint64_t allocCount  = 0;
+
+void* operator new(size_t n) {
+    if (countAllocs) allocCount++;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return ::operator new(n); }
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"   // free() of our own malloc()
+void  operator delete(void* p) noexcept { free(p); }
+#pragma GCC diagnostic pop
+void  operator delete[](void* p) noexcept { ::operator delete(p); }
+void  operator delete(void* p, size_t) noexcept { ::operator delete(p); }
+void  operator delete[](void* p, size_t) noexcept { ::operator delete(p); }
+
+static inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static inline uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ─── RAM-backed log file ────────────────────────────────────
+// Log writes land in a fixed 1 MB region (wrapping), so a long run
+// neither allocates nor grows; everything else goes to MemStorage.
+class RamLogFile : public FileHandle {
+public:
+    uint64_t bytes = 0;
+
+    int read() override { return -1; }
+    int read(void*, size_t) override { return 0; }
+    size_t write(const uint8_t* buf, size_t n) override {
+        size_t done = 0;
+        while (done < n) {
+            size_t at = (size_t)((bytes + done) % sizeof(ram));
+            size_t k  = min(n - done, sizeof(ram) - at);
+            memcpy(ram + at, buf + done, k);
+            done += k;
+        }
+        bytes += n;
+        return n;
+    }
+    void flush() override {}
+    uint64_t size() override { return bytes; }
+    uint64_t position() override { return bytes; }
+    bool seek(uint64_t p) override { return p == bytes; }
+    using FileHandle::write;
+
+private:
+    uint8_t ram[1 << 20];
+};
+
+class BenchStorage : public Storage {
+public:
+    MemStorage  mem;
+    RamLogFile* log = new RamLogFile;
+    bool        logOpen = false;
+
+    bool exists(const char* path) override { return mem.exists(path); }
+    bool mkdir(const char* path) override  { return mem.mkdir(path); }
+    bool remove(const char* path) override { return mem.remove(path); }
+    FileHandle* open(const char* path, FileMode mode) override {
+        if (mode == FileMode::Read || logOpen) return mem.open(path, mode);
+        logOpen = true;
+        return log;
+    }
+    void close(FileHandle* f) override {
+        if (f == log) logOpen = false;
+        else mem.close(f);
+    }
+};
+
+// ─── Simulated ECU ──────────────────────────────────────────
+static PosixClock   benchClock;
+static PosixRtc     benchRtc;
+static MemEcuPort   port;
+static BenchStorage storage;
+
+Hal hal = { &benchClock, &benchRtc, &port, &storage, nullptr, nullptr, nullptr };
+
+static std::vector<std::vector<uint8_t>> replies;   // pre-framed 'O' replies
+static size_t   replyIdx = 0;
+static uint64_t served   = 0;
+
+static void frameCorpus(const std::vector<uint8_t>& corpus, size_t block) {
+    replies.clear();
+    replyIdx = 0;
+    for (size_t off = 0; off + block <= corpus.size(); off += block) {
+        std::vector<uint8_t> f;
+        f.push_back((uint8_t)((block + 1) >> 8));
+        f.push_back((uint8_t)(block + 1));
+        size_t payload = f.size();
+        f.push_back(0x00);
+        f.insert(f.end(), corpus.begin() + off, corpus.begin() + off + block);
+        uint32_t c = crc32(f.data() + payload, block + 1);
+        for (int s = 24; s >= 0; s -= 8) f.push_back((uint8_t)(c >> s));
+        replies.push_back(std::move(f));
+    }
+}
+
+// Answers each command as soon as the logger writes it.
+static void onEcuWrite(MemEcuPort& p) {
+    size_t i = 0;
+    while (i < p.tx.size()) {
+        uint8_t c = p.tx[i];
+        if (c == 'S') {
+            static const char sig[] = "rusEFI bench\n";
+            p.rx.insert(p.rx.end(), sig, sig + sizeof(sig) - 1);
+            i++;
+        } else if (c == 'F') {
+            static const char ok[] = "001\n";
+            p.rx.insert(p.rx.end(), ok, ok + sizeof(ok) - 1);
+            i++;
+        } else if (c == 0x00) {
+            if (p.tx.size() - i < 11) break;
+            const std::vector<uint8_t>& r = replies[replyIdx];
+            replyIdx = (replyIdx + 1) % replies.size();
+            p.rx.insert(p.rx.end(), r.begin(), r.end());
+            served++;
+            i += 11;
+        } else {
+            i++;
+        }
+    }
+    if (i == p.tx.size()) p.tx.clear();
+    else p.tx.erase(p.tx.begin(), p.tx.begin() + i);
+}
+
+// ─── Suites ─────────────────────────────────────────────────
+struct Suite { const char* name; };
+static const Suite SUITES[] = { { "small_datalog" }, { "full_300" }, { "wide_float" } };
+
+struct Result {
+    double parseUs = 0, rowsPerS = 0, bytesPerS = 0, cyclesPerRow = 0;
+    uint64_t allocs = 0, bytesPerRow = 0;
+};
+
+static bool readFile(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) { perror(path.c_str()); return false; }
+    char buf[4096];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static bool runSuite(const char* dir, const Suite& s, uint32_t rows, int reps, Result& r) {
+    std::string ini, corpus;
+    if (!readFile(std::string(dir) + "/ini/" + s.name + ".ini", ini)) return false;
+    if (!readFile(std::string(dir) + "/corpus/" + s.name + ".och", corpus)) return false;
+    storage.mem.put("DEFAULT.INI", ini);
+
+    // INI parse, best of reps.
+    Serial.muted = true;
+    double best = 1e30;
+    for (int i = 0; i < reps; i++) {
+        uint64_t t0 = nowNs();
+        Step st = Step::Failed;
+        if (beginINI("DEFAULT.INI")) while ((st = stepINI()) == Step::Pending) {}
+        double us = (nowNs() - t0) / 1e3;
+        if (st != Step::Done) { Serial.muted = false; fprintf(stderr, "%s: INI parse failed\n", s.name); return false; }
+        if (us < best) best = us;
+    }
+    r.parseUs = best;
+    if (corpus.size() < ochBlockSize) { Serial.muted = false; fprintf(stderr, "%s: corpus shorter than one blob\n", s.name); return false; }
+    frameCorpus(std::vector<uint8_t>(corpus.begin(), corpus.end()), ochBlockSize);
+
+    // Fresh connection: handshake runs through the real timed states.
+    port.rx.clear(); port.rxPos = 0; port.tx.clear();
+    port.link = true;
+    loggerBegin(true);
+    uint32_t startMs = halMillis();
+    while (loggerState() != State::Logging) {
+        loggerStep();
+        loggerDrainTask();
+        if (halMillis() - startMs > 5000) {
+            Serial.muted = false;
+            fprintf(stderr, "%s: no Logging state (stuck in %s)\n", s.name, stateName(loggerState()));
+            return false;
+        }
+    }
+
+    // Logging: a warm-up segment sizes the timed ones to at least
+    // MIN_SEGMENT_NS so fast suites are not dominated by timer noise.
+    auto segment = [](uint64_t n) {
+        uint64_t target = served + n;
+        while (served <= target) {
+            loggerStep();
+            loggerDrainTask();
+        }
+    };
+    static constexpr uint64_t MIN_SEGMENT_NS = 250000000;
+    uint64_t w0 = nowNs();
+    segment(1000);
+    uint64_t perRowNs = max((nowNs() - w0) / 1000, (uint64_t)1);
+    if ((uint64_t)rows * perRowNs < MIN_SEGMENT_NS) rows = (uint32_t)(MIN_SEGMENT_NS / perRowNs);
+
+    // reps segments of `rows` rows; keep the fastest.
+    uint64_t bestNs = UINT64_MAX, bestCycles = 0, bestBytes = 0;
+    allocCount = 0;
+    for (int i = 0; i < reps; i++) {
+        uint64_t b0 = storage.log->bytes;
+        uint64_t c0 = cycles(), t0 = nowNs();
+        countAllocs = true;
+        segment(rows);
+        countAllocs = false;
+        uint64_t ns = nowNs() - t0, cy = cycles() - c0;
+        if (ns < bestNs) { bestNs = ns; bestCycles = cy; bestBytes = storage.log->bytes - b0; }
+    }
+    loggerCommand('s');
+    Serial.muted = false;
+
+    r.rowsPerS     = rows / (bestNs / 1e9);
+    r.bytesPerS    = bestBytes / (bestNs / 1e9);
+    r.cyclesPerRow = (double)bestCycles / rows;
+    r.allocs       = allocCount;
+    r.bytesPerRow  = bestBytes / rows;
+    return true;
+}
+
+// ─── Baselines ──────────────────────────────────────────────
+// One "suite metric value" triple per line.
+typedef std::map<std::string, double> Baseline;
+
+static const char* METRICS[] = { "parse_us", "rows_per_s", "bytes_per_s", "cycles_per_row", "allocs" };
+
+static double metric(const Result& r, const char* m) {
+    if (!strcmp(m, "parse_us"))       return r.parseUs;
+    if (!strcmp(m, "rows_per_s"))     return r.rowsPerS;
+    if (!strcmp(m, "bytes_per_s"))    return r.bytesPerS;
+    if (!strcmp(m, "cycles_per_row")) return r.cyclesPerRow;
+    return (double)r.allocs;
+}
+
+static bool higherIsBetter(const char* m) { return !strcmp(m, "rows_per_s") || !strcmp(m, "bytes_per_s"); }
+
+static bool loadBaseline(const char* path, Baseline& b) {
+    FILE* f = fopen(path, "r");
+    if (!f) { perror(path); return false; }
+    char suite[64], m[64];
+    double v;
+    while (fscanf(f, "%63s %63s %lf", suite, m, &v) == 3) b[std::string(suite) + " " + m] = v;
+    fclose(f);
+    return true;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [--dir DIR] [--rows N] [--reps N] [--suite NAME]\n"
+        "          [--save FILE | --check FILE [--tolerance PCT]]\n"
+        "  --dir DIR        directory holding ini/ and corpus/ (default tools/bench)\n"
+        "  --rows N         minimum rows per timed segment (default 2000;\n"
+        "                   raised so each segment lasts >= 250 ms)\n"
+        "  --reps N         segments / INI parses per suite, best kept (default 5)\n"
+        "  --suite NAME     run one suite only\n"
+        "  --save FILE      write results as a baseline\n"
+        "  --check FILE     compare against a baseline; exit 1 on regression\n"
+        "  --tolerance PCT  allowed regression for timing metrics (default 10)\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* dir   = "tools/bench";
+    const char* only  = nullptr;
+    const char* save  = nullptr;
+    const char* check = nullptr;
+    uint32_t rows = 2000;
+    int      reps = 5;
+    double   tol  = 10;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if      (!strcmp(a, "--dir")       && more) dir   = argv[++i];
+        else if (!strcmp(a, "--rows")      && more) rows  = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--reps")      && more) reps  = atoi(argv[++i]);
+        else if (!strcmp(a, "--suite")     && more) only  = argv[++i];
+        else if (!strcmp(a, "--save")      && more) save  = argv[++i];
+        else if (!strcmp(a, "--check")     && more) check = argv[++i];
+        else if (!strcmp(a, "--tolerance") && more) tol   = atof(argv[++i]);
+        else { usage(argv[0]); return 2; }
+    }
+    if (rows == 0 || reps <= 0) { usage(argv[0]); return 2; }
+
+    Baseline base;
+    if (check && !loadBaseline(check, base)) return 2;
+
+    port.onWrite  = onEcuWrite;
+    port.rx.reserve(1 << 16);   // keep harness growth out of the alloc count
+    port.tx.reserve(1 << 10);
+    pollIntervalMs = 0;
+    rtcOK = false;
+
+    FILE* out = save ? fopen(save, "w") : nullptr;
+    if (save && !out) { perror(save); return 2; }
+
+    printf("[BENCH] >= %u rows x %d reps per suite\n", rows, reps);
+    printf("[BENCH] suite          parse us     rows/s      MB/s  cycles/row  bytes/row  allocs\n");
+    int regressions = 0;
+    for (const Suite& s : SUITES) {
+        if (only && strcmp(only, s.name)) continue;
+        Result r;
+        if (!runSuite(dir, s, rows, reps, r)) return 2;
+        printf("[BENCH] %-13s %9.1f %10.0f %9.2f %11.0f %10llu %7llu\n",
+            s.name, r.parseUs, r.rowsPerS, r.bytesPerS / 1e6, r.cyclesPerRow,
+            (unsigned long long)r.bytesPerRow, (unsigned long long)r.allocs);
+
+        for (const char* m : METRICS) {
+            double v = metric(r, m);
+            if (out) fprintf(out, "%s %s %.3f\n", s.name, m, v);
+            auto it = base.find(std::string(s.name) + " " + m);
+            if (it == base.end()) continue;
+            double b = it->second;
+            bool bad;
+            if (!strcmp(m, "allocs"))  bad = v > b;
+            else if (higherIsBetter(m)) bad = v < b * (1 - tol / 100);
+            else                        bad = v > b * (1 + tol / 100);
+            if (bad) {
+                printf("[BENCH] REGRESSION %s %s: %.1f vs baseline %.1f (%+.1f%%)\n",
+                    s.name, m, v, b, b ? (v - b) * 100 / b : 0.0);
+                regressions++;
+            }
+        }
+    }
+    if (out) { fclose(out); printf("[BENCH] Baseline saved to %s\n", save); }
+    if (check) printf("[BENCH] %d regression(s) against %s (tolerance %.0f%%)\n", regressions, check, tol);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+// ============================================================
+//  catalog.cpp — rebuild CATALOG.CSV from the logs on a card
+// ============================================================
+//
+//  The logger appends one line per log to /CATALOG.CSV when the log
+//  closes. If the catalog is lost (deleted, logs copied in, power cut
+//  before close) this walks the card and rebuilds it from the .msl
+//  files themselves:
+//
+//    catalog /media/SDCARD [--ini DEFAULT.INI] [--out FILE]
+//
+//  start and signature come from the quoted preamble lines, duration
+//  from the last Time value, rows from the data lines. Key-channel
+//  min/max use CATALOG_KEYS from config.h; logs written with a
+//  [Datalog] section label their columns, so pass the INI to map
+//  channel names to labels.
+// ============================================================
+#include "../../src/config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Entry {
+    std::string path, start, signature;
+    double      duration = 0;
+    uint32_t    rows = 0;
+    bool        have[CATALOG_KEY_COUNT] = {};
+    double      mn[CATALOG_KEY_COUNT] = {}, mx[CATALOG_KEY_COUNT] = {};
+};
+
+static std::string unquote(std::string s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.pop_back();
+    if (s.size() >= 2 && s.front() == '"' && s.back() == '"') s = s.substr(1, s.size() - 2);
+    return s;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    size_t a = 0;
+    for (;;) {
+        size_t b = s.find(sep, a);
+        out.push_back(s.substr(a, b == std::string::npos ? std::string::npos : b - a));
+        if (b == std::string::npos) return out;
+        a = b + 1;
+    }
+}
+
+static std::string trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r\n\""), b = s.find_last_not_of(" \t\r\n\"");
+    return a == std::string::npos ? "" : s.substr(a, b - a + 1);
+}
+
+// Channel name → [Datalog] label, from `entry = name, "label", ...` lines.
+static std::map<std::string, std::string> loadLabels(const char* ini) {
+    std::map<std::string, std::string> labels;
+    std::ifstream in(ini);
+    if (!in) { perror(ini); exit(2); }
+    std::string line;
+    bool inDL = false;
+    while (std::getline(in, line)) {
+        size_t sc = line.find(';');
+        if (sc != std::string::npos) line.resize(sc);
+        std::string t = trim(line);
+        if (t.empty()) continue;
+        if (t[0] == '[') { inDL = t.rfind("[Datalog]", 0) == 0; continue; }
+        if (!inDL || t.rfind("entry", 0) != 0) continue;
+        size_t eq = t.find('=');
+        if (eq == std::string::npos) continue;
+        std::vector<std::string> f = split(t.substr(eq + 1), ',');
+        if (f.size() >= 2) labels[trim(f[0])] = trim(f[1]);
+    }
+    return labels;
+}
+
+static bool scanLog(const fs::path& file, const std::string& rel,
+                    const std::map<std::string, std::string>& labels, Entry& e) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+    e.path = rel;
+
+    std::string line;
+    std::vector<std::string> cols;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[0] == '"') {
+            std::string q = unquote(line);
+            if (q.rfind("Capture Date: ", 0) == 0) e.start = q.substr(14);
+            else if (e.signature.empty())          e.signature = q;
+            continue;
+        }
+        cols = split(unquote(line), '\t');
+        break;
+    }
+    if (cols.empty() || cols[0] != "Time") return false;
+    std::getline(in, line);   // units
+
+    int idx[CATALOG_KEY_COUNT];
+    for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+        std::string want = CATALOG_KEYS[k];
+        auto it = labels.find(want);
+        idx[k] = -1;
+        for (size_t c = 0; c < cols.size(); c++)
+            if (cols[c] == want || (it != labels.end() && cols[c] == it->second)) { idx[k] = (int)c; break; }
+    }
+
+    while (std::getline(in, line)) {
+        if (line.empty() || line == "\r") continue;
+        std::vector<std::string> v = split(line, '\t');
+        // A torn last row (power cut mid-write) is shorter than the header.
+        if (v.size() < cols.size()) break;
+        e.rows++;
+        e.duration = atof(v[0].c_str());
+        for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+            if (idx[k] < 0) continue;
+            double x = atof(v[idx[k]].c_str());
+            if (!e.have[k] || x < e.mn[k]) e.mn[k] = x;
+            if (!e.have[k] || x > e.mx[k]) e.mx[k] = x;
+            e.have[k] = true;
+        }
+    }
+    return true;
+}
+
+static void csvQuoted(FILE* f, const std::string& s) {
+    fputc('"', f);
+    for (char c : s) { if (c == '"') fputc('"', f); fputc(c, f); }
+    fputc('"', f);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s CARD_DIR [--ini FILE] [--out FILE]\n"
+        "  --ini FILE   map [Datalog] labels back to channel names\n"
+        "  --out FILE   write here instead of CARD_DIR/CATALOG.CSV (- = stdout)\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* card = nullptr;
+    const char* ini  = nullptr;
+    std::string out;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if      (!strcmp(a, "--ini") && more) ini = argv[++i];
+        else if (!strcmp(a, "--out") && more) out = argv[++i];
+        else if (a[0] != '-' && !card)        card = a;
+        else { usage(argv[0]); return 2; }
+    }
+    if (!card) { usage(argv[0]); return 2; }
+    if (out.empty()) out = (fs::path(card) / "CATALOG.CSV").string();
+
+    std::map<std::string, std::string> labels;
+    if (ini) labels = loadLabels(ini);
+
+    std::vector<Entry> entries;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(card, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_regular_file() || it->path().extension() != ".msl") continue;
+        Entry e;
+        std::string rel = fs::relative(it->path(), card).generic_string();
+        if (scanLog(it->path(), rel, labels, e)) entries.push_back(e);
+        else fprintf(stderr, "[CAT] %s: no MSL header, skipped\n", rel.c_str());
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+    FILE* f = out == "-" ? stdout : fopen(out.c_str(), "w");
+    if (!f) { perror(out.c_str()); return 1; }
+    fprintf(f, "path,start,duration_s,rows,signature");
+    for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) fprintf(f, ",%s_min,%s_max", CATALOG_KEYS[k], CATALOG_KEYS[k]);
+    fprintf(f, "\r\n");
+    for (const Entry& e : entries) {
+        csvQuoted(f, e.path);
+        fprintf(f, ",%s,%.1f,%u,", e.start.c_str(), e.duration, e.rows);
+        csvQuoted(f, e.signature);
+        for (uint8_t k = 0; k < CATALOG_KEY_COUNT; k++) {
+            if (e.have[k]) fprintf(f, ",%.2f,%.2f", e.mn[k], e.mx[k]);
+            else           fprintf(f, ",,");
+        }
+        fprintf(f, "\r\n");
+    }
+    if (f != stdout) fclose(f);
+    fprintf(stderr, "[CAT] %zu logs → %s\n", entries.size(), out.c_str());
+    return 0;
+}
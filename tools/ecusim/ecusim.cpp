@@ -0,0 +1,426 @@
+// ============================================================
+//  ecusim.cpp — simulated TunerStudio / rusEFI ECU for the host build
+// ============================================================
+//
+//  Speaks the subset of the protocol logger.cpp uses:
+//    'S'                     → signature text
+//    'F'                     → "001" (CRC binary protocol)
+//    [len][O off16 cnt16][crc] → [len][0x00 + blob slice][crc]
+//
+//  With --ini the request layout is the INI's ochGetCommand, and reads
+//  longer than its blockingFactor (or --blocking N) are refused with
+//  status 0x84, like firmware with a small transmit buffer.
+//
+//  Blobs come from a recorded capture (concatenated ochBlockSize
+//  records, looped) or are synthesised from the INI channel table.
+//  Replies can be delayed, jittered, truncated or corrupted to exercise
+//  the logger's timeout and CRC paths.
+//
+//  Two ways to connect:
+//    ecusim --ini DEFAULT.INI --pty            prints "[SIM] pty: PATH" for
+//                                              program --port PATH
+//    ecusim --ini DEFAULT.INI -- .pio/build/native/program --ram --ini DEFAULT.INI
+//                                              spawns the logger on one end of a
+//                                              socketpair (--fd 3 is appended)
+// ============================================================
+#include "../../src/crc32.h"
+#include "../../src/ini.h"
+#include "../../src/native/hal_posix.h"
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+static PosixClock   simClock;
+static PosixRtc     simRtc;
+static PosixStorage* iniStorage = nullptr;
+
+Hal hal = { &simClock, &simRtc, nullptr, nullptr, nullptr, nullptr, nullptr };
+
+// ─── Options ────────────────────────────────────────────────
+struct SimOptions {
+    const char* ini        = nullptr;
+    const char* capture    = nullptr;
+    const char* signature  = "rusEFI sim.2025.09.ecusim";
+    uint32_t    block      = 0;      // ochBlockSize override (capture without INI)
+    uint32_t    blocking   = 0;      // longest read served; 0 = the INI's blockingFactor
+    uint32_t    latencyUs  = 300;
+    uint32_t    jitterUs   = 0;
+    double      dropRate   = 0;      // per reply: delete one byte
+    double      corruptRate = 0;     // per reply: flip one payload bit
+    uint32_t    seed       = 1;
+    long        seconds    = 0;      // 0 = until the peer goes away
+    bool        pty        = false;
+    const char* record     = nullptr;  // write synthesised blobs to a file and exit
+    uint32_t    recordCount = 0;
+};
+
+struct SimStats {
+    uint64_t requests = 0, badRequests = 0, bytesOut = 0;
+    uint64_t dropped = 0, corrupted = 0;
+    uint32_t firstUs = 0, lastUs = 0;
+    uint32_t minGapUs = UINT32_MAX, maxGapUs = 0;
+};
+
+static SimOptions opt;
+static SimStats   stats;
+static std::mt19937 rng;
+
+// ─── Blob source ────────────────────────────────────────────
+static std::vector<uint8_t> capture;
+static size_t               captureRecords = 0, captureIdx = 0;
+static std::vector<uint8_t> blob;
+
+// Values go out in the INI's `endianness`, as a real ECU would send them.
+static void putBytes(uint8_t* p, const void* v, size_t n) {
+    memcpy(p, v, n);
+    if (ochCommand.bigEndian) std::reverse(p, p + n);
+}
+static void getBytes(void* v, const uint8_t* p, size_t n) {
+    uint8_t b[4];
+    memcpy(b, p, n);
+    if (ochCommand.bigEndian) std::reverse(b, b + n);
+    memcpy(v, b, n);
+}
+template <typename T> static void put(uint8_t* p, T v) { putBytes(p, &v, sizeof(T)); }
+
+// Each channel follows its own slow sine so every column changes and
+// decode/format costs are realistic. Raw values are chosen so that the
+// scaled value stays in a plausible range for its type.
+static void synthesise(uint32_t nowUs) {
+    double t = nowUs / 1e6;
+    for (uint16_t i = 0; i < numChannels; i++) {
+        const Channel& ch = channels[i];
+        double s = sin(t * (0.3 + 0.07 * (i % 13)) + i);
+        if (ch.dk == DK_EXPR) continue;
+        uint8_t* p = blob.data() + ch.offset;
+        if (ch.dk == DK_BITS) {
+            // Only this field of the shared word; flags toggle at their own rate.
+            uint8_t  n = ch.tc == TC_U08 || ch.tc == TC_S08 ? 1 : ch.tc == TC_U16 || ch.tc == TC_S16 ? 2 : 4;
+            uint32_t w = 0, mask = 0xFFFFFFFFu >> (32 - ch.bitWidth);
+            getBytes(&w, p, n);
+            w = (w & ~(mask << ch.bitLo)) | ((uint32_t)((s + 1) / 2 * mask + 0.5) << ch.bitLo);
+            putBytes(p, &w, n);
+            continue;
+        }
+        switch (ch.tc) {
+            case TC_U08: put<uint8_t >(p, (uint8_t )(128 + 100 * s));     break;
+            case TC_S08: put<int8_t  >(p, (int8_t  )(100 * s));           break;
+            case TC_U16: put<uint16_t>(p, (uint16_t)(30000 + 25000 * s)); break;
+            case TC_S16: put<int16_t >(p, (int16_t )(20000 * s));         break;
+            case TC_U32: put<uint32_t>(p, (uint32_t)(nowUs / 1000 + i));  break;
+            case TC_S32: put<int32_t >(p, (int32_t )(1000000 * s));       break;
+            case TC_F32: put<float   >(p, (float   )(100 * s));           break;
+            default: break;
+        }
+    }
+}
+
+static void nextBlob(uint32_t nowUs) {
+    if (captureRecords) {
+        memcpy(blob.data(), capture.data() + captureIdx * blob.size(), blob.size());
+        captureIdx = (captureIdx + 1) % captureRecords;
+    } else {
+        synthesise(nowUs);
+    }
+}
+
+// ─── Protocol ───────────────────────────────────────────────
+struct Reply { uint32_t dueUs; std::vector<uint8_t> bytes; };
+static std::deque<Reply> replies;
+static std::vector<uint8_t> rx;
+
+// Faults are only injected into 'O' replies so the handshake stays stable.
+static void queueReply(uint32_t nowUs, std::vector<uint8_t> bytes, bool faults = false) {
+    uint32_t delay = opt.latencyUs;
+    if (opt.jitterUs) delay += rng() % (opt.jitterUs + 1);
+    std::uniform_real_distribution<double> u(0, 1);
+    if (faults && u(rng) < opt.corruptRate) {
+        bytes[3 + rng() % (bytes.size() - 7)] ^= (uint8_t)(1u << (rng() % 8));
+        stats.corrupted++;
+    }
+    if (faults && u(rng) < opt.dropRate) {
+        bytes.erase(bytes.begin() + rng() % bytes.size());
+        stats.dropped++;
+    }
+    // Replies leave in order even when jitter would reorder them.
+    uint32_t due = nowUs + delay;
+    if (!replies.empty() && (int32_t)(due - replies.back().dueUs) < 0) due = replies.back().dueUs;
+    replies.push_back({ due, std::move(bytes) });
+}
+
+static std::vector<uint8_t> frame(const uint8_t* payload, size_t n) {
+    std::vector<uint8_t> f;
+    f.push_back((uint8_t)(n >> 8));
+    f.push_back((uint8_t)n);
+    f.insert(f.end(), payload, payload + n);
+    uint32_t c = crc32(payload, n);
+    for (int s = 24; s >= 0; s -= 8) f.push_back((uint8_t)(c >> s));
+    return f;
+}
+
+static void handleOCH(uint32_t nowUs, uint16_t off, uint16_t cnt) {
+    stats.requests++;
+    if (stats.firstUs == 0) stats.firstUs = nowUs;
+    if (stats.lastUs) {
+        uint32_t gap = nowUs - stats.lastUs;
+        if (gap < stats.minGapUs) stats.minGapUs = gap;
+        if (gap > stats.maxGapUs) stats.maxGapUs = gap;
+    }
+    stats.lastUs = nowUs;
+
+    std::vector<uint8_t> payload(1 + cnt, 0);
+    if ((size_t)off + cnt > blob.size() || (opt.blocking && cnt > opt.blocking)) {
+        payload.assign(1, 0x84);   // out of range
+    } else {
+        nextBlob(nowUs);
+        memcpy(payload.data() + 1, blob.data() + off, cnt);
+    }
+    queueReply(nowUs, frame(payload.data(), payload.size()), true);
+}
+
+static uint32_t field(const uint8_t* p, uint8_t width) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < width; i++)
+        v |= (uint32_t)p[ochCommand.bigEndian ? width - 1 - i : i] << (8 * i);
+    return v;
+}
+
+// An output-channel request: the INI's ochGetCommand, or plain 'O'
+// when replaying a capture without one.
+static bool parseOCH(const uint8_t* pl, size_t len, uint16_t& off, uint16_t& cnt) {
+    if (!opt.ini) {
+        if (len != 5 || pl[0] != 'O') return false;
+        off = (uint16_t)(pl[1] | pl[2] << 8);
+        cnt = (uint16_t)(pl[3] | pl[4] << 8);
+        return true;
+    }
+    if (len != ochCommand.len) return false;
+    off = ochCommand.offWidth ? (uint16_t)field(pl + ochCommand.offPos, ochCommand.offWidth) : 0;
+    cnt = ochCommand.cntWidth ? (uint16_t)field(pl + ochCommand.cntPos, ochCommand.cntWidth) : (uint16_t)blob.size();
+    uint8_t want[OCH_CMD_MAX];
+    ochRequest(off, cnt, want);
+    return memcmp(pl, want, len) == 0;
+}
+
+// Consume as many complete commands from rx as possible.
+static void parse(uint32_t nowUs) {
+    size_t i = 0;
+    while (i < rx.size()) {
+        uint8_t c = rx[i];
+        if (c == 'S') {
+            std::string s = std::string(opt.signature) + "\n";
+            queueReply(nowUs, std::vector<uint8_t>(s.begin(), s.end()));
+            i++;
+        } else if (c == 'F') {
+            const char* v = "001\n";
+            queueReply(nowUs, std::vector<uint8_t>(v, v + 4));
+            i++;
+        } else if (c == 0x00) {
+            if (rx.size() - i < 2) break;
+            size_t len = ((size_t)rx[i] << 8) | rx[i + 1];
+            if (rx.size() - i < 2 + len + 4) break;
+            const uint8_t* pl = rx.data() + i + 2;
+            const uint8_t* cc = pl + len;
+            uint32_t want = ((uint32_t)cc[0] << 24) | ((uint32_t)cc[1] << 16) | ((uint32_t)cc[2] << 8) | cc[3];
+            uint16_t off, cnt;
+            if (crc32(pl, len) == want && parseOCH(pl, len, off, cnt)) {
+                handleOCH(nowUs, off, cnt);
+            } else {
+                stats.badRequests++;
+            }
+            i += 2 + len + 4;
+        } else {
+            i++;   // line noise / unsupported plain command
+        }
+    }
+    rx.erase(rx.begin(), rx.begin() + i);
+}
+
+// ─── Setup ──────────────────────────────────────────────────
+static bool loadINI(const char* path) {
+    std::string p(path);
+    size_t slash = p.find_last_of('/');
+    std::string dir  = slash == std::string::npos ? "." : p.substr(0, slash);
+    std::string name = slash == std::string::npos ? p : p.substr(slash + 1);
+    iniStorage = new PosixStorage(dir.c_str());
+    hal.fs = iniStorage;
+    if (!beginINI(name.c_str())) return false;
+    Step s;
+    while ((s = stepINI()) == Step::Pending) {}
+    return s == Step::Done;
+}
+
+static bool loadCapture(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) capture.insert(capture.end(), buf, buf + n);
+    fclose(f);
+    captureRecords = capture.size() / blob.size();
+    if (!captureRecords) { fprintf(stderr, "%s: shorter than one %zu-byte record\n", path, blob.size()); return false; }
+    fprintf(stderr, "[SIM] Capture: %zu records of %zu bytes\n", captureRecords, blob.size());
+    return true;
+}
+
+// Corpus for tools/bench: N blobs on a 20 Hz timebase, no transport.
+static bool recordBlobs() {
+    FILE* f = fopen(opt.record, "wb");
+    if (!f) { perror(opt.record); return false; }
+    for (uint32_t i = 0; i < opt.recordCount; i++) {
+        nextBlob(i * 50000);
+        fwrite(blob.data(), 1, blob.size(), f);
+    }
+    fclose(f);
+    fprintf(stderr, "[SIM] Recorded %u blobs of %zu bytes to %s\n", opt.recordCount, blob.size(), opt.record);
+    return true;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s (--ini FILE | --block N) [options] (--pty | --record FILE N | -- LOGGER ARGS...)\n"
+        "  --ini FILE          channel layout + ochBlockSize for synthetic blobs\n"
+        "  --block N           ochBlockSize when replaying a capture without an INI\n"
+        "  --capture FILE      replay concatenated ochBlockSize-byte blobs (looped)\n"
+        "  --blocking N        refuse reads over N bytes (default: INI blockingFactor)\n"
+        "  --signature STR     reply to 'S' (default \"%s\")\n"
+        "  --latency-us N      reply delay (default %u)\n"
+        "  --jitter-us N       extra uniform random delay 0..N\n"
+        "  --drop-rate P       probability a reply loses one byte\n"
+        "  --corrupt-rate P    probability a reply has one payload bit flipped\n"
+        "  --seed N            RNG seed (default 1)\n"
+        "  --seconds N         stop after N s (default: when the peer exits)\n"
+        "  --pty               serve on a pseudo-terminal and print its path\n"
+        "  --record FILE N     write N blobs (20 Hz timebase) to FILE and exit\n"
+        "  -- CMD ARGS...      spawn CMD ARGS... --fd 3 on a socketpair\n",
+        argv0, opt.signature, opt.latencyUs);
+}
+
+static volatile sig_atomic_t stopFlag = 0;
+static void onSignal(int) { stopFlag = 1; }
+
+int main(int argc, char** argv) {
+    char** child = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if      (!strcmp(a, "--"))                       { child = argv + i + 1; break; }
+        else if (!strcmp(a, "--ini")          && more) opt.ini         = argv[++i];
+        else if (!strcmp(a, "--capture")      && more) opt.capture     = argv[++i];
+        else if (!strcmp(a, "--signature")    && more) opt.signature   = argv[++i];
+        else if (!strcmp(a, "--block")        && more) opt.block       = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--blocking")     && more) opt.blocking    = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--latency-us")   && more) opt.latencyUs   = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--jitter-us")    && more) opt.jitterUs    = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--drop-rate")    && more) opt.dropRate    = atof(argv[++i]);
+        else if (!strcmp(a, "--corrupt-rate") && more) opt.corruptRate = atof(argv[++i]);
+        else if (!strcmp(a, "--seed")         && more) opt.seed        = (uint32_t)atol(argv[++i]);
+        else if (!strcmp(a, "--seconds")      && more) opt.seconds     = atol(argv[++i]);
+        else if (!strcmp(a, "--pty"))                  opt.pty         = true;
+        else if (!strcmp(a, "--record")  && i + 2 < argc) { opt.record = argv[++i]; opt.recordCount = (uint32_t)atol(argv[++i]); }
+        else { usage(argv[0]); return 2; }
+    }
+    if ((!opt.ini && !opt.block) || (!opt.pty && !opt.record && !(child && *child))) { usage(argv[0]); return 2; }
+    rng.seed(opt.seed);
+
+    if (opt.ini && !loadINI(opt.ini)) return 1;
+    if (opt.ini && !opt.blocking) opt.blocking = ochCommand.blockingFactor;
+    blob.assign(opt.block ? opt.block : ochBlockSize, 0);
+    if (opt.capture && !loadCapture(opt.capture)) return 1;
+    if (opt.record) return recordBlobs() ? 0 : 1;
+
+    int   fd  = -1;
+    pid_t pid = -1;
+    if (opt.pty) {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) || unlockpt(fd)) { perror("pty"); return 1; }
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        printf("[SIM] pty: %s\n", ptsname(fd));
+        fflush(stdout);
+    } else {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) { perror("socketpair"); return 1; }
+        pid = fork();
+        if (pid == 0) {
+            close(sv[0]);   // may itself be fd 3 — close before dup2
+            if (sv[1] != 3) { dup2(sv[1], 3); close(sv[1]); }
+            std::vector<char*> args;
+            for (char** a = child; *a; a++) args.push_back(*a);
+            static char fdFlag[] = "--fd", fdNum[] = "3";
+            args.push_back(fdFlag);
+            args.push_back(fdNum);
+            args.push_back(nullptr);
+            execvp(args[0], args.data());
+            perror(args[0]);
+            _exit(127);
+        }
+        close(sv[1]);
+        fd = sv[0];
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    const uint32_t startMs = simClock.millis();
+    bool peerGone = false;
+    while (!stopFlag && !peerGone) {
+        uint32_t now = simClock.micros();
+        int timeoutMs = 20;
+        if (!replies.empty()) {
+            int32_t wait = (int32_t)(replies.front().dueUs - now);
+            timeoutMs = wait <= 0 ? 0 : (wait + 999) / 1000;
+        }
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, timeoutMs) > 0) {
+            uint8_t buf[4096];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) { rx.insert(rx.end(), buf, buf + n); parse(simClock.micros()); }
+            // A pty master reads EIO while no one has the slave open — keep waiting.
+            else if (!opt.pty && (n == 0 || errno != EAGAIN)) peerGone = true;
+            else if (opt.pty && n < 0 && errno == EIO) usleep(10000);
+        }
+        now = simClock.micros();
+        while (!replies.empty() && (int32_t)(now - replies.front().dueUs) >= 0) {
+            const std::vector<uint8_t>& b = replies.front().bytes;
+            size_t done = 0;
+            while (done < b.size()) {
+                ssize_t w = write(fd, b.data() + done, b.size() - done);
+                if (w > 0) done += w;
+                else if (w < 0 && errno == EAGAIN) usleep(100);
+                else { peerGone = true; break; }
+            }
+            stats.bytesOut += done;
+            replies.pop_front();
+        }
+        if (opt.seconds > 0 && simClock.millis() - startMs >= (uint32_t)opt.seconds * 1000) break;
+        if (pid > 0 && waitpid(pid, nullptr, WNOHANG) == pid) { pid = -1; peerGone = true; }
+    }
+
+    if (pid > 0) { kill(pid, SIGTERM); waitpid(pid, nullptr, 0); }
+
+    double secs = stats.lastUs > stats.firstUs ? (stats.lastUs - stats.firstUs) / 1e6 : 0;
+    fprintf(stderr, "[SIM] Requests: %llu (bad %llu)  served %.1f req/s over %.2f s\n",
+        (unsigned long long)stats.requests, (unsigned long long)stats.badRequests,
+        secs > 0 ? (stats.requests - 1) / secs : 0.0, secs);
+    fprintf(stderr, "[SIM] Request gap: min %u us  max %u us\n",
+        stats.minGapUs == UINT32_MAX ? 0 : stats.minGapUs, stats.maxGapUs);
+    fprintf(stderr, "[SIM] Bytes out: %llu  truncated replies: %llu  corrupted replies: %llu\n",
+        (unsigned long long)stats.bytesOut, (unsigned long long)stats.dropped,
+        (unsigned long long)stats.corrupted);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// ============================================================
+//  expand.cpp — sparse .tsb log → dense .msl
+// ============================================================
+//
+//  Replays a change-of-value log (see src/sparse.h) into the same
+//  tab-separated text the logger writes in normal mode: the stored MSL
+//  header verbatim, then one row per record with every column at its
+//  last written value.
+//
+//    expand LOG001.tsb [more.tsb ...]      → LOG001.msl next to each
+//    expand LOG001.tsb -o -                → stdout
+// ============================================================
+#include "expand.h"
+#include "../../src/sparse.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct Reader {
+    std::vector<uint8_t> buf;
+    size_t pos = 0;
+    bool   bad = false;
+
+    bool     more() const { return pos < buf.size(); }
+    uint8_t  u8()  { if (pos >= buf.size()) { bad = true; return 0; } return buf[pos++]; }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 70; shift += 7) {
+            uint8_t b = u8();
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        bad = true;
+        return v;
+    }
+    float f32() {
+        float v = 0;
+        if (pos + 4 > buf.size()) { bad = true; pos = buf.size(); return 0; }
+        memcpy(&v, &buf[pos], 4);
+        pos += 4;
+        return v;
+    }
+};
+
+// Same rounding as the logger's printFixed(): v in units of 10^-from,
+// shown with `to` decimals, half away from zero.
+static void printFixed(FILE* out, int64_t v, int from, int to) {
+    int64_t p = 1;
+    for (int i = 0; i < (from > to ? from - to : to - from); i++) p *= 10;
+    if (from > to) v = (v + (v < 0 ? -p / 2 : p / 2)) / p;
+    else           v *= p;
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    uint64_t scale = 1;
+    for (int i = 0; i < to; i++) scale *= 10;
+    if (v < 0) fputc('-', out);
+    fprintf(out, "%llu", (unsigned long long)(u / scale));
+    if (to) fprintf(out, ".%0*llu", to, (unsigned long long)(u % scale));
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+    uint8_t tmp[65536];
+    size_t n;
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) out.insert(out.end(), tmp, tmp + n);
+    fclose(f);
+    return true;
+}
+
+int expandLog(const char* in, const std::string& outPath) {
+    Reader r;
+    if (!readFile(in, r.buf)) return 1;
+    if (r.buf.size() < 6 || memcmp(r.buf.data(), "TSB1", 4) != 0) {
+        fprintf(stderr, "%s: not a sparse log (no TSB1 magic)\n", in);
+        return 1;
+    }
+    r.pos = 4;
+    uint16_t cols = r.u8();
+    cols |= (uint16_t)r.u8() << 8;
+    std::vector<uint8_t> store(cols), show(cols);   // see sparse.h
+    std::vector<uint8_t> word(cols), lo(cols), width(cols);
+    for (uint16_t c = 0; c < cols; c++) {
+        store[c] = r.u8();
+        if (store[c] == SPARSE_STORE_BITS) { word[c] = r.u8(); lo[c] = r.u8(); width[c] = r.u8(); }
+        show[c] = r.u8();
+    }
+    // Packed words are hidden integer columns after the real ones.
+    uint16_t slots = cols + r.u8();
+    store.resize(slots, 1);
+    for (uint16_t c = 0; c < cols; c++) {
+        if (store[c] == SPARSE_STORE_BITS && (cols + word[c] >= slots || width[c] == 0 || width[c] > 32)) {
+            fprintf(stderr, "%s: bad packed column %u\n", in, c);
+            return 1;
+        }
+    }
+    size_t hdrStart = r.pos;
+    while (r.more() && r.buf[r.pos] != 0) r.pos++;
+    if (!r.more()) { fprintf(stderr, "%s: header not terminated\n", in); return 1; }
+    size_t hdrEnd = r.pos++;
+
+    FILE* out = outPath == "-" ? stdout : fopen(outPath.c_str(), "wb");
+    if (!out) { perror(outPath.c_str()); return 1; }
+    fwrite(&r.buf[hdrStart], 1, hdrEnd - hdrStart, out);
+
+    std::vector<float>   values(slots, 0.0f);
+    std::vector<int64_t> fixed(slots, 0);
+    std::vector<uint16_t> present;
+    uint64_t ms = 0;
+    uint32_t rows = 0;
+    while (r.more()) {
+        size_t recStart = r.pos;
+        uint8_t tag = r.u8();
+        ms += r.varint();
+        present.clear();
+        if (tag == SPARSE_TAG_LIST) {
+            uint64_t n = r.varint();
+            uint64_t idx = 0;
+            for (uint64_t i = 0; i < n && !r.bad; i++) {
+                idx = i ? idx + r.varint() : r.varint();
+                if (idx >= slots) { r.bad = true; break; }
+                present.push_back((uint16_t)idx);
+            }
+        } else if (tag == SPARSE_TAG_BITMAP) {
+            for (uint16_t b = 0; b < (slots + 7) / 8; b++) {
+                uint8_t bits = r.u8();
+                for (uint8_t k = 0; k < 8; k++)
+                    if (bits & (1 << k) && b * 8 + k < slots) present.push_back(b * 8 + k);
+            }
+        } else {
+            r.bad = true;
+        }
+        for (uint16_t c : present) {
+            if (!store[c]) {
+                values[c] = r.f32();
+            } else {
+                uint64_t z = r.varint();
+                fixed[c] = (int64_t)((z >> 1) ^ (0 - (z & 1)));
+            }
+        }
+        if (r.bad) {
+            // A power cut can leave a partial record at the end.
+            fprintf(stderr, "%s: truncated record at byte %zu, stopping\n", in, recStart);
+            break;
+        }
+
+        // Same formatting as the logger's dense rows.
+        printFixed(out, ms, 3, 3);
+        for (uint16_t c = 0; c < cols; c++) {
+            if (store[c] == SPARSE_STORE_BITS)
+                fixed[c] = ((uint64_t)fixed[cols + word[c]] >> lo[c]) & (0xFFFFFFFFu >> (32 - width[c]));
+        }
+        for (uint16_t c = 0; c < cols; c++) {
+            fputc('\t', out);
+            if (store[c]) {
+                int s = store[c] == SPARSE_STORE_BITS ? 0 : store[c] - 1;
+                if (show[c]) printFixed(out, fixed[c], s, show[c] - 1);
+                else         printFixed(out, fixed[c] / (int64_t)pow(10, s), 0, 0);
+            }
+            else if (show[c] > 1) fprintf(out, "%.*f", show[c] - 1, (double)values[c]);
+            else if (show[c])     fprintf(out, "%ld", lroundf(values[c]));
+            else                  fprintf(out, "%ld", (long)(int32_t)values[c]);
+        }
+        fprintf(out, "\r\n");
+        rows++;
+    }
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "[EXP] %s: %u rows, %zu bytes → %s\n", in, rows, r.buf.size(), outPath.c_str());
+    return 0;
+}
@@ -0,0 +1,10 @@
+// ============================================================
+//  expand.h — sparse .tsb log → dense .msl
+// ============================================================
+#pragma once
+
+#include <string>
+
+// Expand one .tsb into outPath ("-" = stdout). 0 on success; reasons
+// go to stderr.
+int expandLog(const char* in, const std::string& outPath);
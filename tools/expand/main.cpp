@@ -0,0 +1,31 @@
+// ============================================================
+//  main.cpp — expand command line
+// ============================================================
+#include "expand.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::vector<const char*> inputs;
+    const char* out = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) out = argv[++i];
+        else if (argv[i][0] == '-') { inputs.clear(); break; }
+        else inputs.push_back(argv[i]);
+    }
+    if (inputs.empty() || (out && inputs.size() > 1)) {
+        fprintf(stderr, "usage: %s FILE.tsb [FILE.tsb ...] | %s FILE.tsb -o OUT.msl|-\n", argv[0], argv[0]);
+        return 2;
+    }
+    int rc = 0;
+    for (const char* in : inputs) {
+        std::string o = out ? out : in;
+        if (!out) {
+            size_t dot = o.find_last_of('.');
+            o = (dot == std::string::npos ? o : o.substr(0, dot)) + ".msl";
+        }
+        rc |= expandLog(in, o);
+    }
+    return rc;
+}
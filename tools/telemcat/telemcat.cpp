@@ -0,0 +1,117 @@
+// ============================================================
+//  telemcat.cpp — live telemetry stream → tab-separated text
+// ============================================================
+//
+//  Reads the frames described in src/telem.h from a file, FIFO or a
+//  serial port captured to stdin, skips console text between them, and
+//  prints one line per record: time, seq and every decoded column, with
+//  the column names as the first line. Raw-mode records print the blob
+//  as hex (decode them with the INI the header's signature names).
+//
+//    telemcat /tmp/tlm.fifo
+//    cat /dev/ttyACM0 | telemcat -
+// ============================================================
+#include "../../src/crc32.h"
+#include "../../src/telem.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static constexpr uint16_t FRAME_LIMIT = 16384;   // longer "frames" are text that happened to hold the sync byte
+
+static uint16_t u16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t u32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+struct Column { std::string name, unit; int digits = 3; };
+
+static uint8_t             mode = 0;
+static uint16_t            cols = 0, block = 0;
+static std::vector<Column> columns;
+static bool                headed = false;
+static uint32_t            records = 0, gaps = 0, badFrames = 0;
+static uint16_t            lastSeq = 0;
+
+static void onFrame(uint8_t type, const uint8_t* p, uint16_t len) {
+    if (type == 'H' && len >= 6) {
+        mode  = p[1];
+        cols  = u16(p + 2);
+        block = u16(p + 4);
+        columns.assign(mode == 0 ? cols : 0, Column());
+        headed = false;
+        fprintf(stderr, "[TLM] %s: %s, %u columns, block %u\n",
+            std::string((const char*)p + 6, strnlen((const char*)p + 6, len - 6)).c_str(),
+            mode == 0 ? "decoded" : "raw", cols, block);
+    } else if (type == 'C' && len >= 5 && u16(p) < columns.size()) {
+        Column& c = columns[u16(p)];
+        c.digits = p[2];
+        const char* s = (const char*)p + 3;
+        size_t n = strnlen(s, len - 3);
+        c.name = std::string(s, n);
+        if (3 + n + 1 < len) c.unit = std::string(s + n + 1, strnlen(s + n + 1, len - 3 - n - 1));
+    } else if (type == 'R' && len >= 6) {
+        uint16_t seq = u16(p + 4);
+        if (records && (uint16_t)(seq - lastSeq) != 1) gaps++;
+        lastSeq = seq;
+        records++;
+        if (!headed) {
+            printf("Time\tSeq");
+            for (const Column& c : columns) printf("\t%s", c.name.c_str());
+            printf(mode == 0 ? "\n" : "\tBlob\n");
+            headed = true;
+        }
+        printf("%.3f\t%u", u32(p) / 1000.0, seq);
+        if (mode == 0) {
+            for (uint16_t c = 0; c < columns.size() && 6 + (c + 1) * 4 <= len; c++) {
+                float v;
+                memcpy(&v, p + 6 + c * 4, 4);
+                printf("\t%.*f", columns[c].digits, (double)v);
+            }
+        } else {
+            putchar('\t');
+            for (uint16_t i = 6; i < len; i++) printf("%02x", p[i]);
+        }
+        putchar('\n');
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s STREAM|-\n", argv[0]);
+        return 2;
+    }
+    FILE* in = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+    if (!in) { perror(argv[1]); return 1; }
+
+    // Scan for the sync byte; a frame whose CRC fails was console text
+    // (or damaged), so resume one byte after that sync.
+    std::vector<uint8_t> buf;
+    uint8_t tmp[4096];
+    ssize_t n;
+    size_t pos = 0;
+    while ((n = read(fileno(in), tmp, sizeof(tmp))) > 0) {   // whatever has arrived, not a full 4 KB
+        buf.insert(buf.end(), tmp, tmp + n);
+        for (;;) {
+            while (pos < buf.size() && buf[pos] != TELEM_SYNC) pos++;
+            if (buf.size() - pos < 8) break;
+            uint16_t len = u16(&buf[pos + 2]);
+            if (len > FRAME_LIMIT) { badFrames++; pos++; continue; }
+            if (buf.size() - pos < 8u + len) break;
+            const uint8_t* f = &buf[pos];
+            if (crc32(f + 1, 3 + len) == u32(f + 4 + len)) {
+                onFrame(f[1], f + 4, len);
+                pos += 8 + len;
+            } else {
+                badFrames++;
+                pos++;
+            }
+        }
+        buf.erase(buf.begin(), buf.begin() + pos);
+        pos = 0;
+        fflush(stdout);
+    }
+    fprintf(stderr, "[TLM] %u records, %u seq gaps, %u bad frames\n", records, gaps, badFrames);
+    return 0;
+}